@@ -0,0 +1,365 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dwarf.h>
+
+#include "appleaccel.h"
+
+/* Apple's accelerator tables, .apple_names, .apple_types, and the
+ * rest, all look like:
+ *
+ *      header
+ *      header data     die_offset_base, then what each entry holds
+ *      buckets         uint32_t[bucket_count]
+ *      hashes          uint32_t[hashes_count]
+ *      offsets         uint32_t[hashes_count]
+ *      hash data
+ *
+ * Names with the same hash share a run of hash data:
+ *
+ *      .debug_str offset of the name, 0 ends the run
+ *      entry count
+ *      entries         one value per atom
+ *
+ * dSYMs have them in the __DWARF segment, and clang -glldb puts them
+ * in ELF files too. They come from the same toolchain that wrote the
+ * rest of the file, so like objfile.c, multi byte values are read in
+ * our byte order.
+ */
+
+#define APPLEACCEL_MAGIC (0x48415348)
+#define APPLEACCEL_HASH_DJB (0)
+#define APPLEACCEL_EMPTY_BUCKET (0xffffffff)
+
+/* Not in every dwarf.h */
+#ifndef DW_ATOM_die_offset
+#define DW_ATOM_die_offset (1)
+#endif
+
+#ifndef DW_ATOM_die_tag
+#define DW_ATOM_die_tag (3)
+#endif
+
+struct appleaccel_atom {
+    uint16_t aa_type;
+    uint16_t aa_form;
+};
+
+struct appleaccel {
+    const unsigned char *ac_data;
+    uint64_t ac_size;
+
+    uint32_t ac_bucketcount;
+    uint32_t ac_hashcount;
+    const unsigned char *ac_buckets;
+    const unsigned char *ac_hashes;
+    const unsigned char *ac_offsets;
+
+    uint32_t ac_dieoffsetbase;
+    struct appleaccel_atom *ac_atoms;
+    uint32_t ac_numatoms;
+
+    const unsigned char *ac_str;
+    uint64_t ac_strsize;
+};
+
+struct cursor {
+    const unsigned char *c_cur;
+    const unsigned char *c_end;
+
+    /* Set once we've tried to read past c_end */
+    int c_bad;
+};
+
+static uint64_t read_fixed(struct cursor *c, int size){
+    if(c->c_bad || c->c_end - c->c_cur < size){
+        c->c_bad = 1;
+        return 0;
+    }
+
+    uint64_t val = 0;
+
+    if(size == 1)
+        val = *c->c_cur;
+    else if(size == 2){
+        uint16_t v16;
+        memcpy(&v16, c->c_cur, sizeof(v16));
+        val = v16;
+    }
+    else if(size == 4){
+        uint32_t v32;
+        memcpy(&v32, c->c_cur, sizeof(v32));
+        val = v32;
+    }
+    else if(size == 8)
+        memcpy(&val, c->c_cur, sizeof(val));
+
+    c->c_cur += size;
+
+    return val;
+}
+
+static uint64_t read_uleb(struct cursor *c){
+    uint64_t val = 0;
+    int shift = 0;
+
+    while(!c->c_bad){
+        if(c->c_cur >= c->c_end){
+            c->c_bad = 1;
+            break;
+        }
+
+        unsigned char byte = *c->c_cur++;
+
+        if(shift < 64)
+            val |= (uint64_t)(byte & 0x7f) << shift;
+
+        shift += 7;
+
+        if(!(byte & 0x80))
+            break;
+    }
+
+    return val;
+}
+
+/* Sets c_bad for a form we don't know the size of */
+static uint64_t read_atom(struct cursor *c, struct appleaccel *ac,
+        uint16_t form){
+    switch(form){
+        case DW_FORM_data1:
+        case DW_FORM_flag:
+            return read_fixed(c, 1);
+        case DW_FORM_data2:
+            return read_fixed(c, 2);
+        case DW_FORM_data4:
+            return read_fixed(c, 4);
+        case DW_FORM_data8:
+            return read_fixed(c, 8);
+        case DW_FORM_udata:
+            return read_uleb(c);
+        /* Only these are relative to die_offset_base */
+        case DW_FORM_ref1:
+            return ac->ac_dieoffsetbase + read_fixed(c, 1);
+        case DW_FORM_ref2:
+            return ac->ac_dieoffsetbase + read_fixed(c, 2);
+        case DW_FORM_ref4:
+            return ac->ac_dieoffsetbase + read_fixed(c, 4);
+        case DW_FORM_ref8:
+            return ac->ac_dieoffsetbase + read_fixed(c, 8);
+        case DW_FORM_ref_udata:
+            return ac->ac_dieoffsetbase + read_uleb(c);
+        default:
+            c->c_bad = 1;
+            return 0;
+    }
+}
+
+/* Returns NULL if the table is empty or isn't something we can read.
+ * Nothing is copied, both sections have to outlive the returned table.
+ */
+struct appleaccel *appleaccel_new(const unsigned char *data, uint64_t size,
+        const unsigned char *str, uint64_t strsize){
+    if(!data || !str)
+        return NULL;
+
+    struct cursor c = { data, data + size, 0 };
+
+    uint32_t magic = read_fixed(&c, 4);
+    uint16_t version = read_fixed(&c, 2);
+    uint16_t hashfunction = read_fixed(&c, 2);
+    uint32_t bucketcount = read_fixed(&c, 4);
+    uint32_t hashcount = read_fixed(&c, 4);
+    uint32_t headerdatalen = read_fixed(&c, 4);
+
+    if(c.c_bad || magic != APPLEACCEL_MAGIC || version != 1 ||
+            hashfunction != APPLEACCEL_HASH_DJB || bucketcount == 0){
+        return NULL;
+    }
+
+    struct cursor hdr = { c.c_cur, c.c_cur + headerdatalen, 0 };
+
+    if(headerdatalen > (uint64_t)(c.c_end - c.c_cur))
+        return NULL;
+
+    c.c_cur += headerdatalen;
+
+    struct appleaccel *ac = calloc(1, sizeof(struct appleaccel));
+    ac->ac_data = data;
+    ac->ac_size = size;
+    ac->ac_str = str;
+    ac->ac_strsize = strsize;
+    ac->ac_bucketcount = bucketcount;
+    ac->ac_hashcount = hashcount;
+    ac->ac_dieoffsetbase = read_fixed(&hdr, 4);
+    ac->ac_numatoms = read_fixed(&hdr, 4);
+
+    if(hdr.c_bad ||
+            ac->ac_numatoms > (uint64_t)(hdr.c_end - hdr.c_cur) / 4){
+        appleaccel_free(ac);
+        return NULL;
+    }
+
+    ac->ac_atoms = calloc(ac->ac_numatoms + 1,
+            sizeof(struct appleaccel_atom));
+
+    for(uint32_t i=0; i<ac->ac_numatoms; i++){
+        ac->ac_atoms[i].aa_type = read_fixed(&hdr, 2);
+        ac->ac_atoms[i].aa_form = read_fixed(&hdr, 2);
+    }
+
+    uint64_t tablesize = (uint64_t)bucketcount * 4 +
+        (uint64_t)hashcount * 8;
+
+    if(tablesize > (uint64_t)(c.c_end - c.c_cur)){
+        appleaccel_free(ac);
+        return NULL;
+    }
+
+    ac->ac_buckets = c.c_cur;
+    ac->ac_hashes = ac->ac_buckets + ((uint64_t)bucketcount * 4);
+    ac->ac_offsets = ac->ac_hashes + ((uint64_t)hashcount * 4);
+
+    return ac;
+}
+
+void appleaccel_free(struct appleaccel *ac){
+    if(!ac)
+        return;
+
+    free(ac->ac_atoms);
+    free(ac);
+}
+
+/* Bernstein's hash, no case folding */
+static uint32_t appleaccel_hash(const char *name){
+    uint32_t hash = 5381;
+
+    for(const unsigned char *p=(const unsigned char *)name; *p; p++)
+        hash = (hash * 33) + *p;
+
+    return hash;
+}
+
+static uint32_t read_u32_at(const unsigned char *base, uint64_t idx){
+    uint32_t val;
+    memcpy(&val, base + (idx * 4), sizeof(val));
+
+    return val;
+}
+
+static int name_matches(struct appleaccel *ac, uint64_t stroff,
+        const char *name){
+    if(stroff >= ac->ac_strsize)
+        return 0;
+
+    const char *str = (const char *)ac->ac_str + stroff;
+    size_t maxlen = ac->ac_strsize - stroff;
+    size_t namelen = strlen(name);
+
+    return namelen < maxlen && memcmp(str, name, namelen + 1) == 0;
+}
+
+static void add_dieoff(uint64_t **dieoffs, int *len, int *cap,
+        uint64_t off){
+    if(*len == *cap){
+        *cap = *cap ? *cap * 2 : 8;
+
+        uint64_t *dieoffs_rea = realloc(*dieoffs, sizeof(uint64_t) * *cap);
+        *dieoffs = dieoffs_rea;
+    }
+
+    (*dieoffs)[(*len)++] = off;
+}
+
+/* Read one run of hash data, adding the DIE offset of every entry for
+ * name whose tag matches. Entries without a tag always match.
+ */
+static void read_hash_data(struct appleaccel *ac, uint32_t off,
+        const char *name, int tag, uint64_t **dieoffs, int *len, int *cap){
+    if(off >= ac->ac_size)
+        return;
+
+    struct cursor c = { ac->ac_data + off, ac->ac_data + ac->ac_size, 0 };
+
+    for(;;){
+        uint32_t stroff = read_fixed(&c, 4);
+
+        if(c.c_bad || stroff == 0)
+            return;
+
+        uint32_t count = read_fixed(&c, 4);
+        int matches = name_matches(ac, stroff, name);
+
+        for(uint32_t i=0; i<count; i++){
+            uint64_t dieoff = 0, dietag = 0;
+            int hasdieoff = 0, hastag = 0;
+
+            for(uint32_t k=0; k<ac->ac_numatoms; k++){
+                struct appleaccel_atom *atom = &ac->ac_atoms[k];
+                uint64_t val = read_atom(&c, ac, atom->aa_form);
+
+                if(atom->aa_type == DW_ATOM_die_offset){
+                    dieoff = val;
+                    hasdieoff = 1;
+                }
+                else if(atom->aa_type == DW_ATOM_die_tag){
+                    dietag = val;
+                    hastag = 1;
+                }
+            }
+
+            if(c.c_bad)
+                return;
+
+            if(!matches || !hasdieoff)
+                continue;
+
+            if(tag != 0 && hastag && dietag != (uint64_t)tag)
+                continue;
+
+            add_dieoff(dieoffs, len, cap, dieoff);
+        }
+    }
+}
+
+/* Find the .debug_info offset of every DIE named name with tag, any
+ * tag if tag is 0. The array must be freed. Returns 1 if there aren't
+ * any.
+ */
+int appleaccel_find(struct appleaccel *ac, const char *name, int tag,
+        uint64_t **dieoffsout, int *lenout){
+    uint64_t *dieoffs = NULL;
+    int len = 0, cap = 0;
+
+    uint32_t hash = appleaccel_hash(name);
+    uint32_t bucket = hash % ac->ac_bucketcount;
+    uint32_t first = read_u32_at(ac->ac_buckets, bucket);
+
+    if(first == APPLEACCEL_EMPTY_BUCKET)
+        return 1;
+
+    /* Hashes in the same bucket are next to each other */
+    for(uint64_t i=first; i<ac->ac_hashcount; i++){
+        uint32_t h = read_u32_at(ac->ac_hashes, i);
+
+        if(h % ac->ac_bucketcount != bucket)
+            break;
+
+        if(h == hash){
+            read_hash_data(ac, read_u32_at(ac->ac_offsets, i), name, tag,
+                    &dieoffs, &len, &cap);
+        }
+    }
+
+    if(len == 0){
+        free(dieoffs);
+        return 1;
+    }
+
+    *dieoffsout = dieoffs;
+    *lenout = len;
+
+    return 0;
+}
@@ -0,0 +1,14 @@
+#ifndef _APPLEACCEL_H_
+#define _APPLEACCEL_H_
+
+#include <stdint.h>
+
+struct appleaccel;
+
+int appleaccel_find(struct appleaccel *, const char *, int, uint64_t **,
+        int *);
+void appleaccel_free(struct appleaccel *);
+struct appleaccel *appleaccel_new(const unsigned char *, uint64_t,
+        const unsigned char *, uint64_t);
+
+#endif
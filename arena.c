@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define ARENA_ALIGN (sizeof(void *) * 2)
+
+struct arena_chunk {
+    struct arena_chunk *c_prev;
+    size_t c_size;
+    size_t c_used;
+    _Alignas(ARENA_ALIGN) unsigned char c_data[];
+};
+
+static struct arena_chunk *new_chunk(struct arena_chunk *prev, size_t size){
+    struct arena_chunk *chunk = malloc(sizeof(struct arena_chunk) + size);
+
+    chunk->c_prev = prev;
+    chunk->c_size = size;
+    chunk->c_used = 0;
+
+    return chunk;
+}
+
+struct arena *arena_new(size_t chunksz){
+    struct arena *arena = malloc(sizeof(struct arena));
+
+    arena->a_chunksz = chunksz;
+    arena->a_current = new_chunk(NULL, chunksz);
+
+    return arena;
+}
+
+/* Memory comes back zeroed */
+void *arena_alloc(struct arena *arena, size_t size){
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    struct arena_chunk *chunk = arena->a_current;
+
+    if(chunk->c_used + size > chunk->c_size){
+        /* Anything too big for a normal chunk gets one to itself */
+        size_t chunksz = arena->a_chunksz;
+
+        if(size > chunksz)
+            chunksz = size;
+
+        chunk = new_chunk(chunk, chunksz);
+        arena->a_current = chunk;
+    }
+
+    void *mem = chunk->c_data + chunk->c_used;
+    chunk->c_used += size;
+
+    memset(mem, 0, size);
+
+    return mem;
+}
+
+char *arena_strdup(struct arena *arena, const char *str){
+    size_t len = strlen(str) + 1;
+    char *copy = arena_alloc(arena, len);
+
+    memcpy(copy, str, len);
+
+    return copy;
+}
+
+void arena_mark(struct arena *arena, struct arena_mark *mark){
+    mark->m_chunk = arena->a_current;
+    mark->m_used = arena->a_current->c_used;
+}
+
+/* Free everything allocated since mark was taken */
+void arena_release(struct arena *arena, struct arena_mark *mark){
+    while(arena->a_current != mark->m_chunk){
+        struct arena_chunk *prev = arena->a_current->c_prev;
+        free(arena->a_current);
+        arena->a_current = prev;
+    }
+
+    arena->a_current->c_used = mark->m_used;
+}
+
+void arena_free(struct arena *arena){
+    if(!arena)
+        return;
+
+    struct arena_chunk *chunk = arena->a_current;
+
+    while(chunk){
+        struct arena_chunk *prev = chunk->c_prev;
+        free(chunk);
+        chunk = prev;
+    }
+
+    free(arena);
+}
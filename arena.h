@@ -0,0 +1,28 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+struct arena_chunk;
+
+/* Bump allocator. Everything allocated from an arena is freed at once,
+ * by arena_free, or back to a mark, by arena_release.
+ */
+struct arena {
+    struct arena_chunk *a_current;
+    size_t a_chunksz;
+};
+
+struct arena_mark {
+    struct arena_chunk *m_chunk;
+    size_t m_used;
+};
+
+struct arena *arena_new(size_t);
+void *arena_alloc(struct arena *, size_t);
+char *arena_strdup(struct arena *, const char *);
+void arena_mark(struct arena *, struct arena_mark *);
+void arena_release(struct arena *, struct arena_mark *);
+void arena_free(struct arena *);
+
+#endif
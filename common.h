@@ -9,8 +9,111 @@ typedef struct {
 
     Dwarf_Debug di_dbg;
 
+    /* Our DWARF file mapped into memory, every Dwarf_Debug reads its
+     * sections from here. NULL if libdwarf opened it through libelf,
+     * see objfile.c.
+     */
+    struct objfile *di_objfile;
+
+    /* SYM_INIT_* */
+    int di_flags;
+
+    /* Path we were initialized with, parallel loading opens it again
+     * for every worker thread.
+     */
+    char *di_path;
+
     struct linkedlist *di_compunits;
     int di_numcompunits;
+
+    /* Sorted, non-overlapping PC ranges of every compilation unit,
+     * see cu_find_compilation_unit_by_pc.
+     */
+    struct cu_range *di_curanges;
+    int di_numcuranges;
+    int di_curangescap;
+
+    /* Split DWARF package, <di_path>.dwp, opened the first time a
+     * skeleton unit needs it. Tied to di_dbg.
+     */
+    int di_dwptried;
+    Dwarf_Debug di_dwpdbg;
+    int di_dwpfd;
+
+    /* How many split units we've opened, see cu_get_offset_key */
+    int di_numsplitunits;
+
+    /* Each worker thread used for parallel loading gets its own
+     * Dwarf_Debug. They own the DIEs and line tables of every
+     * compilation unit they built, so they live until sym_end.
+     */
+    Dwarf_Debug *di_workerdbgs;
+    /* -1 for workers reading from di_objfile */
+    int *di_workerfds;
+    int di_numworkers;
+
+    /* Every named DIE from every compilation unit whose DIE tree
+     * has been built, see nameindex.c.
+     */
+    void *di_nameindex;
+
+    /* .debug_info offset to DIE, for every compilation unit whose
+     * DIE tree has been built.
+     */
+    struct hashmap *di_dieoffsets;
+
+    /* DIE, type, and file names, shared by every compilation unit,
+     * see strtab.c.
+     */
+    void *di_strtab;
+
+    /* Type DIE offset to its description, shared by every DIE with
+     * that type, see typecache.c.
+     */
+    void *di_typecache;
+
+    /* Canonical structure and union types, only with
+     * SYM_INIT_UNIFY_TYPES, see typeunify.c.
+     */
+    void *di_typeunify;
+
+    /* With SYM_INIT_INDEX_CACHE, the index cache file we loaded
+     * from and its compilation units, in file order. NULL if there
+     * wasn't a usable one, see symcache.c.
+     */
+    void *di_symcache;
+    void **di_symcachecus;
+
+    /* The file's DWARF 5 .debug_names, NULL if it doesn't have one
+     * or it wasn't opened through di_objfile, see debugnames.c.
+     */
+    struct debugnames *di_debugnames;
+
+    /* Apple's accelerator tables for functions and variables, and
+     * for types, NULL if the file doesn't have them, see appleaccel.c.
+     */
+    struct appleaccel *di_applenames;
+    struct appleaccel *di_appletypes;
+
+    /* The file's .gdb_index, NULL if it doesn't have one. If it does,
+     * compilation units and their PC ranges come from here instead
+     * of .debug_info, see gdbindex.c.
+     */
+    struct gdbindex *di_gdbindex;
+
+    /* Function symbols from .symtab and .dynsym, for PCs without
+     * DWARF. Built the first time one of those comes up, NULL if the
+     * file has no symbols or wasn't opened through di_objfile, see
+     * elfsym.c.
+     */
+    int di_elfsymtried;
+    struct elfsym *di_elfsym;
+
+    /* How many anonymous types and lexical blocks we've named so far */
+    int di_lexblockcnt;
+    int di_anonstructcnt;
+    int di_anonunioncnt;
+    int di_anonenumcnt;
 } dwarfinfo_t;
 
 #define dprintf(fmt, ...) do { \
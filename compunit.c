@@ -1,107 +1,1214 @@
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include <dwarf.h>
 #include <libdwarf.h>
 
+#include "appleaccel.h"
 #include "common.h"
+#include "debugnames.h"
+#include "gdbindex.h"
 #include "die.h"
+#include "hashmap.h"
 #include "linkedlist.h"
+#include "nameindex.h"
+#include "objfile.h"
+#include "strtab.h"
+#include "symcache.h"
 #include "symerr.h"
+#include "symflags.h"
 
 typedef struct {
+    dwarfinfo_t *cu_dwarfinfo;
+
+    Dwarf_Unsigned cu_header_offset;
     Dwarf_Unsigned cu_header_len;
     Dwarf_Unsigned cu_abbrev_offset;
     Dwarf_Half cu_address_size;
     Dwarf_Unsigned cu_next_header_offset;
 
-    void *cu_root_die;
-} compunit_t;
+    /* Offset of this compilation unit's root DIE in .debug_info */
+    Dwarf_Off cu_die_offset;
+
+    /* Read straight from the root DWARF DIE, so name and PC queries
+     * don't need the DIE tree to be built. If .debug_aranges covers
+     * this compilation unit, that isn't done until someone needs
+     * them, see read_root_die_attributes.
+     */
+    const char *cu_name;
+    Dwarf_Unsigned cu_low_pc;
+    Dwarf_Unsigned cu_high_pc;
+
+    /* Set if the root DIE has DW_AT_ranges */
+    int cu_hasranges;
+
+    /* Set once the four fields above are valid */
+    int cu_rootread;
+
+    /* NULL until the DIE tree for this compilation unit is built */
+    void *cu_root_die;
+
+    /* The Dwarf_Debug that built this compilation unit's DIE tree.
+     * Not always di_dbg, see cu_load_compilation_units.
+     */
+    Dwarf_Debug cu_dbg;
+
+    /* Split DWARF. If this is a skeleton unit, its DIEs are in a .dwo
+     * file or the .dwp package next to our file, opened the first
+     * time the tree is built, see open_split_unit. cu_splitdbg is
+     * tied to di_dbg so it can read the skeleton's addresses.
+     */
+    int cu_splitchecked;
+    Dwarf_Debug cu_splitdbg;
+    Dwarf_Off cu_splitdieoffset;
+
+    /* Our .dwo file, -1 if cu_splitdbg is the shared .dwp package.
+     * Only valid if cu_splitdbg is set.
+     */
+    int cu_splitfd;
+
+    /* Offsets in a split object start over at 0, so every split unit
+     * gets its own range of keys in di_dieoffsets and the type cache.
+     */
+    uint64_t cu_offsetbias;
+} compunit_t;
+
+/* One entry of the PC to compilation unit lookup table */
+struct cu_range {
+    Dwarf_Unsigned cr_low;
+    Dwarf_Unsigned cr_high;
+    compunit_t *cr_cu;
+};
+
+/* Key for a DIE offset from cu in di_dieoffsets and the type cache */
+uint64_t cu_get_offset_key(compunit_t *cu, Dwarf_Off offset){
+    return cu->cu_offsetbias + offset;
+}
+
+static void add_cu_range(dwarfinfo_t *dwarfinfo, compunit_t *cu,
+        Dwarf_Unsigned low, Dwarf_Unsigned high){
+    if(low >= high)
+        return;
+
+    if(dwarfinfo->di_numcuranges == dwarfinfo->di_curangescap){
+        dwarfinfo->di_curangescap = dwarfinfo->di_curangescap ?
+            dwarfinfo->di_curangescap * 2 : 64;
+
+        struct cu_range *curanges_rea = realloc(dwarfinfo->di_curanges,
+                sizeof(struct cu_range) * dwarfinfo->di_curangescap);
+        dwarfinfo->di_curanges = curanges_rea;
+    }
+
+    struct cu_range *r = &dwarfinfo->di_curanges[dwarfinfo->di_numcuranges++];
+    r->cr_low = low;
+    r->cr_high = high;
+    r->cr_cu = cu;
+}
+
+static int cu_range_cmp(const void *a, const void *b){
+    const struct cu_range *ra = a, *rb = b;
+
+    if(ra->cr_low < rb->cr_low)
+        return -1;
+    else if(ra->cr_low > rb->cr_low)
+        return 1;
+
+    return 0;
+}
+
+/* Sort the ranges we collected while reading headers and make them
+ * non-overlapping, so a PC maps to at most one compilation unit.
+ * If two compilation units claim the same code, the one that
+ * starts first keeps it.
+ */
+static void finalize_cu_ranges(dwarfinfo_t *dwarfinfo){
+    struct cu_range *ranges = dwarfinfo->di_curanges;
+    int len = dwarfinfo->di_numcuranges;
+
+    if(len == 0)
+        return;
+
+    qsort(ranges, len, sizeof(struct cu_range), cu_range_cmp);
+
+    int out = 0;
+
+    for(int i=1; i<len; i++){
+        struct cu_range *prev = &ranges[out];
+        struct cu_range cur = ranges[i];
+
+        if(cur.cr_low < prev->cr_high)
+            cur.cr_low = prev->cr_high;
+
+        if(cur.cr_low >= cur.cr_high)
+            continue;
+
+        /* Adjacent pieces of the same compilation unit */
+        if(cur.cr_cu == prev->cr_cu && cur.cr_low == prev->cr_high){
+            prev->cr_high = cur.cr_high;
+            continue;
+        }
+
+        ranges[++out] = cur;
+    }
+
+    dwarfinfo->di_numcuranges = out + 1;
+}
+
+/* Compilation units whose code isn't contiguous describe it with
+ * DW_AT_ranges instead of a low/high PC pair.
+ */
+static void read_root_die_ranges(dwarfinfo_t *dwarfinfo, compunit_t *cu,
+        Dwarf_Die root){
+    Dwarf_Debug dbg = dwarfinfo->di_dbg;
+    Dwarf_Error d_error = NULL;
+    Dwarf_Attribute attr = NULL;
+
+    int ret = dwarf_attr(root, DW_AT_ranges, &attr, &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    if(ret != DW_DLV_OK)
+        return;
+
+    Dwarf_Off rangesoff = 0;
+    ret = dwarf_global_formref(attr, &rangesoff, &d_error);
+
+    if(ret == DW_DLV_ERROR){
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+        d_error = NULL;
+
+        /* DWARF 2 and 3 use a constant form for this */
+        ret = dwarf_formudata(attr, &rangesoff, &d_error);
+
+        if(ret == DW_DLV_ERROR)
+            dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+    }
+
+    dwarf_dealloc(dbg, attr, DW_DLA_ATTR);
+
+    if(ret != DW_DLV_OK)
+        return;
+
+    Dwarf_Ranges *ranges = NULL;
+    Dwarf_Signed rangescnt = 0;
+    Dwarf_Unsigned bytecnt = 0;
+
+    ret = dwarf_get_ranges_a(dbg, rangesoff, root, &ranges, &rangescnt,
+            &bytecnt, &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    if(ret != DW_DLV_OK)
+        return;
+
+    /* Entries are relative to the compilation unit's base address
+     * until a base address selection entry says otherwise.
+     */
+    Dwarf_Unsigned base = cu->cu_low_pc;
+
+    for(Dwarf_Signed i=0; i<rangescnt; i++){
+        Dwarf_Ranges *r = &ranges[i];
+
+        if(r->dwr_type == DW_RANGES_END)
+            break;
+        else if(r->dwr_type == DW_RANGES_ADDRESS_SELECTION)
+            base = r->dwr_addr2;
+        else{
+            add_cu_range(dwarfinfo, cu, base + r->dwr_addr1,
+                    base + r->dwr_addr2);
+        }
+    }
+
+    dwarf_ranges_dealloc(dbg, ranges, rangescnt);
+
+    cu->cu_hasranges = 1;
+}
+
+/* Everything that has to happen on the calling thread after
+ * a compilation unit's DIE tree is built.
+ */
+static void finish_die_tree(compunit_t *cu){
+    die_tree_name_generated_dies(cu->cu_dwarfinfo, cu->cu_root_die);
+    die_tree_index(cu->cu_dwarfinfo, cu, cu->cu_root_die);
+}
+
+/* Split objects are usually found relative to the directory the
+ * compiler ran in.
+ */
+static char *split_object_path(const char *dir, const char *name){
+    if(name[0] == '/' || !dir)
+        return strdup(name);
+
+    size_t len = strlen(dir) + 1 + strlen(name) + 1;
+    char *path = malloc(len);
+    snprintf(path, len, "%s/%s", dir, name);
+
+    return path;
+}
+
+/* Same, but relative to the directory our file is in */
+static char *split_object_path_near(const char *file, const char *name){
+    const char *slash = file ? strrchr(file, '/') : NULL;
+
+    if(name[0] == '/' || !slash)
+        return strdup(name);
+
+    size_t dirlen = slash - file;
+    size_t len = dirlen + 1 + strlen(name) + 1;
+    char *path = malloc(len);
+    snprintf(path, len, "%.*s/%s", (int)dirlen, file, name);
+
+    return path;
+}
+
+static char *get_root_die_string(Dwarf_Debug dbg, Dwarf_Die root,
+        Dwarf_Half attrnum){
+    Dwarf_Error d_error = NULL;
+    Dwarf_Attribute attr = NULL;
+
+    int ret = dwarf_attr(root, attrnum, &attr, &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    if(ret != DW_DLV_OK)
+        return NULL;
+
+    char *str = NULL, *result = NULL;
+    ret = dwarf_formstring(attr, &str, &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    /* Owned by libdwarf, but only as long as the attribute */
+    if(ret == DW_DLV_OK)
+        result = strdup(str);
+
+    dwarf_dealloc(dbg, attr, DW_DLA_ATTR);
+
+    return result;
+}
+
+static int open_split_dbg(const char *path, Dwarf_Debug tied,
+        Dwarf_Debug *dbgout, int *fdout){
+    Dwarf_Error d_error = NULL;
+    int fd = open(path, O_RDONLY);
+
+    if(fd < 0)
+        return 1;
+
+    if(dwarf_init(fd, DW_DLC_READ, NULL, NULL, dbgout, &d_error) !=
+            DW_DLV_OK){
+        close(fd);
+        return 1;
+    }
+
+    if(dwarf_set_tied_dbg(*dbgout, tied, &d_error) != DW_DLV_OK){
+        dwarf_finish(*dbgout, &d_error);
+        close(fd);
+        return 1;
+    }
+
+    *fdout = fd;
+
+    return 0;
+}
+
+/* Find the split unit with dwoid in the .dwp package next to our
+ * file, opening it if this is the first time.
+ */
+static int find_in_dwp(dwarfinfo_t *dwarfinfo, Dwarf_Sig8 *dwoid,
+        Dwarf_Off *dieoffout){
+    if(!dwarfinfo->di_dwptried){
+        dwarfinfo->di_dwptried = 1;
+
+        if(dwarfinfo->di_path){
+            size_t len = strlen(dwarfinfo->di_path) + sizeof(".dwp");
+            char *path = malloc(len);
+            snprintf(path, len, "%s.dwp", dwarfinfo->di_path);
+
+            if(open_split_dbg(path, dwarfinfo->di_dbg, &dwarfinfo->di_dwpdbg,
+                        &dwarfinfo->di_dwpfd)){
+                dwarfinfo->di_dwpdbg = NULL;
+            }
+
+            free(path);
+        }
+    }
+
+    if(!dwarfinfo->di_dwpdbg)
+        return 1;
+
+    Dwarf_Debug dbg = dwarfinfo->di_dwpdbg;
+    Dwarf_Error d_error = NULL;
+    Dwarf_Die die = NULL;
+
+    int ret = dwarf_die_from_hash_signature(dbg, dwoid, "cu", &die,
+            &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    if(ret != DW_DLV_OK)
+        return 1;
+
+    ret = dwarf_dieoffset(die, dieoffout, &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    dwarf_dealloc(dbg, die, DW_DLA_DIE);
+
+    return ret != DW_DLV_OK;
+}
+
+/* A .dwo file holds one compilation unit */
+static int find_in_dwo(const char *path, Dwarf_Debug tied,
+        Dwarf_Debug *dbgout, int *fdout, Dwarf_Off *dieoffout){
+    if(open_split_dbg(path, tied, dbgout, fdout))
+        return 1;
+
+    Dwarf_Debug dbg = *dbgout;
+    Dwarf_Error d_error = NULL;
+    Dwarf_Unsigned header_len, abbrev_offset, typeoff, next_header_offset;
+    Dwarf_Half ver, address_size, len_sz, ext_sz, hdr_type;
+    Dwarf_Sig8 sig;
+    int is_info = 1;
+
+    int ret = dwarf_next_cu_header_d(dbg, is_info, &header_len, &ver,
+            &abbrev_offset, &address_size, &len_sz, &ext_sz, &sig, &typeoff,
+            &next_header_offset, &hdr_type, &d_error);
+
+    if(ret == DW_DLV_OK){
+        ret = dwarf_get_cu_die_offset_given_cu_header_offset_b(dbg, 0,
+                is_info, dieoffout, &d_error);
+    }
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    if(ret != DW_DLV_OK){
+        dwarf_finish(dbg, &d_error);
+        close(*fdout);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* If cu is a skeleton unit, find the split object with its DIEs:
+ * the .dwp package first, then the .dwo file it names, relative to
+ * its DW_AT_comp_dir and then to our file. If none of them can be
+ * opened, only the skeleton gets built, which still has the line
+ * table.
+ */
+static void open_split_unit(compunit_t *cu){
+    dwarfinfo_t *dwarfinfo = cu->cu_dwarfinfo;
+    Dwarf_Debug dbg = dwarfinfo->di_dbg;
+    Dwarf_Error d_error = NULL;
+    Dwarf_Die root = NULL;
+    int is_info = 1;
+
+    if(cu->cu_splitchecked)
+        return;
+
+    cu->cu_splitchecked = 1;
+    cu->cu_splitfd = -1;
+
+    int ret = dwarf_offdie_b(dbg, cu->cu_die_offset, is_info, &root,
+            &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    if(ret != DW_DLV_OK)
+        return;
+
+    /* DWARF 5, then the GNU extension it came from */
+    char *dwoname = get_root_die_string(dbg, root, DW_AT_dwo_name);
+
+    if(!dwoname)
+        dwoname = get_root_die_string(dbg, root, DW_AT_GNU_dwo_name);
+
+    if(!dwoname){
+        dwarf_dealloc(dbg, root, DW_DLA_DIE);
+        return;
+    }
+
+    char *compdir = get_root_die_string(dbg, root, DW_AT_comp_dir);
+
+    Dwarf_Half version, offset_size, address_size, extension_size;
+    Dwarf_Bool isinfo, isdwo;
+    Dwarf_Sig8 *dwoid = NULL;
+    Dwarf_Off offset_of_length;
+    Dwarf_Unsigned total_byte_length;
+
+    ret = dwarf_cu_header_basics(root, &version, &isinfo, &isdwo,
+            &offset_size, &address_size, &extension_size, &dwoid,
+            &offset_of_length, &total_byte_length, &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    if(ret != DW_DLV_OK)
+        dwoid = NULL;
+
+    if(dwoid && !find_in_dwp(dwarfinfo, dwoid, &cu->cu_splitdieoffset))
+        cu->cu_splitdbg = dwarfinfo->di_dwpdbg;
+
+    char *paths[] = {
+        split_object_path(compdir, dwoname),
+        split_object_path_near(dwarfinfo->di_path, dwoname)
+    };
+
+    for(int i=0; i<2 && !cu->cu_splitdbg; i++){
+        if(!find_in_dwo(paths[i], dbg, &cu->cu_splitdbg, &cu->cu_splitfd,
+                    &cu->cu_splitdieoffset)){
+            break;
+        }
+
+        cu->cu_splitdbg = NULL;
+    }
+
+    /* Under 2^40 bytes of DWARF per object */
+    if(cu->cu_splitdbg){
+        cu->cu_offsetbias =
+            (uint64_t)(++dwarfinfo->di_numsplitunits) << 40;
+    }
+
+    free(paths[0]);
+    free(paths[1]);
+    free(compdir);
+    free(dwoname);
+
+    dwarf_dealloc(dbg, root, DW_DLA_DIE);
+}
+
+/* Build cu's tree with dbg, or with its split object if it has one.
+ * Split objects are tied to di_dbg, so those are only ever built on
+ * the calling thread.
+ */
+static int build_die_tree_with(compunit_t *cu, Dwarf_Debug dbg,
+        sym_error_t *e){
+    void *root_die = NULL;
+    int ret;
+
+    if(cu->cu_splitdbg){
+        dbg = cu->cu_splitdbg;
+        ret = initialize_and_build_die_tree_from_root_die(dbg, cu,
+                cu->cu_splitdieoffset, cu->cu_dwarfinfo->di_dbg,
+                cu->cu_die_offset, &root_die, e);
+    }
+    else{
+        ret = initialize_and_build_die_tree_from_root_die(dbg, cu,
+                cu->cu_die_offset, NULL, 0, &root_die, e);
+    }
+
+    if(ret)
+        return 1;
+
+    cu->cu_root_die = root_die;
+    cu->cu_dbg = dbg;
+
+    return 0;
+}
+
+static int build_die_tree(compunit_t *cu, sym_error_t *e){
+    open_split_unit(cu);
+
+    if(build_die_tree_with(cu, cu->cu_dwarfinfo->di_dbg, e))
+        return 1;
+
+    finish_die_tree(cu);
+
+    return 0;
+}
+
+struct cu_build_queue {
+    pthread_mutex_t q_lock;
+
+    /* Compilation units in the order they appear in .debug_info */
+    compunit_t **q_cus;
+    int q_numcus;
+    int q_next;
+
+    /* One per compilation unit, set if building its tree failed */
+    sym_error_t *q_errors;
+};
+
+struct cu_build_worker {
+    struct cu_build_queue *w_queue;
+    Dwarf_Debug w_dbg;
+};
+
+static void *cu_build_worker_thread(void *arg){
+    struct cu_build_worker *worker = arg;
+    struct cu_build_queue *queue = worker->w_queue;
+
+    for(;;){
+        pthread_mutex_lock(&queue->q_lock);
+        int idx = queue->q_next++;
+        pthread_mutex_unlock(&queue->q_lock);
+
+        if(idx >= queue->q_numcus)
+            break;
+
+        compunit_t *cu = queue->q_cus[idx];
+
+        /* Left for the calling thread */
+        if(cu->cu_splitdbg)
+            continue;
+
+        build_die_tree_with(cu, worker->w_dbg, &queue->q_errors[idx]);
+    }
+
+    return NULL;
+}
+
+static int open_worker_dbgs(dwarfinfo_t *dwarfinfo, int count,
+        sym_error_t *e){
+    dwarfinfo->di_workerdbgs = calloc(count, sizeof(Dwarf_Debug));
+    dwarfinfo->di_workerfds = calloc(count, sizeof(int));
+
+    /* libdwarf and libelf aren't safe to initialize concurrently, so
+     * every worker's Dwarf_Debug is opened here before any of them start.
+     */
+    for(int i=0; i<count; i++){
+        Dwarf_Error d_error = NULL;
+
+        /* Workers share the mapping, nobody gets their own copy of
+         * the sections.
+         */
+        if(dwarfinfo->di_objfile){
+            if(objfile_dwarf_init(dwarfinfo->di_objfile,
+                        &dwarfinfo->di_workerdbgs[i], &d_error) != DW_DLV_OK){
+                errset(e, SYM_ERROR_KIND, SYM_DWARF_INIT_FAILED);
+                return 1;
+            }
+
+            dwarfinfo->di_workerfds[i] = -1;
+            dwarfinfo->di_numworkers++;
+
+            continue;
+        }
+
+        int fd = open(dwarfinfo->di_path, O_RDONLY);
+
+        if(fd < 0){
+            errset(e, GENERIC_ERROR_KIND, GE_FILE_NOT_FOUND);
+            return 1;
+        }
+
+        int ret = dwarf_init(fd, DW_DLC_READ, NULL, NULL,
+                &dwarfinfo->di_workerdbgs[i], &d_error);
+
+        if(ret != DW_DLV_OK){
+            close(fd);
+            errset(e, SYM_ERROR_KIND, SYM_DWARF_INIT_FAILED);
+            return 1;
+        }
+
+        dwarfinfo->di_workerfds[i] = fd;
+        dwarfinfo->di_numworkers++;
+    }
+
+    return 0;
+}
+
+/* What building a DIE tree reads */
+static const char *build_sections[] = {
+    ".debug_info", ".debug_abbrev", ".debug_str", ".debug_line",
+    ".debug_line_str", ".debug_ranges", ".debug_rnglists", ".debug_loc",
+    ".debug_loclists", ".debug_addr", ".debug_str_offsets"
+};
+
+/* A Dwarf_Debug can't be shared between threads, so each worker builds
+ * trees with its own. Workers pull compilation units off a shared queue
+ * and finish_die_tree runs afterwards, in .debug_info order, so the
+ * result is the same as building them one by one.
+ */
+static int build_die_trees_in_parallel(dwarfinfo_t *dwarfinfo,
+        compunit_t **cus, int numcus, sym_error_t *e){
+    int numworkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    if(numworkers > numcus)
+        numworkers = numcus;
+
+    if(numworkers < 1)
+        numworkers = 1;
+
+    /* Otherwise the first worker to touch a compressed section would
+     * inflate it while the rest wait on it.
+     */
+    if(dwarfinfo->di_objfile){
+        objfile_inflate_sections(dwarfinfo->di_objfile, build_sections,
+                sizeof(build_sections) / sizeof(*build_sections),
+                (int)sysconf(_SC_NPROCESSORS_ONLN));
+    }
+
+    if(open_worker_dbgs(dwarfinfo, numworkers, e))
+        return 1;
+
+    /* libdwarf can't open these concurrently either */
+    for(int i=0; i<numcus; i++)
+        open_split_unit(cus[i]);
+
+    struct cu_build_queue queue = {0};
+    pthread_mutex_init(&queue.q_lock, NULL);
+    queue.q_cus = cus;
+    queue.q_numcus = numcus;
+    queue.q_errors = calloc(numcus, sizeof(sym_error_t));
+
+    struct cu_build_worker *workers =
+        calloc(numworkers, sizeof(struct cu_build_worker));
+    pthread_t *threads = calloc(numworkers, sizeof(pthread_t));
+
+    int numstarted = 0;
+
+    for(int i=0; i<numworkers; i++){
+        workers[i].w_queue = &queue;
+        workers[i].w_dbg = dwarfinfo->di_workerdbgs[i];
+
+        if(pthread_create(&threads[i], NULL, cu_build_worker_thread,
+                    &workers[i]) != 0){
+            break;
+        }
+
+        numstarted++;
+    }
+
+    /* If we couldn't start them all, the calling thread takes the
+     * first one that didn't start's place. The queue still gets
+     * drained, just with fewer threads.
+     */
+    if(numstarted < numworkers)
+        cu_build_worker_thread(&workers[numstarted]);
+
+    for(int i=0; i<numstarted; i++)
+        pthread_join(threads[i], NULL);
+
+    int ret = 0;
+
+    for(int i=0; i<numcus; i++){
+        if(cus[i]->cu_splitdbg)
+            build_die_tree_with(cus[i], dwarfinfo->di_dbg, &queue.q_errors[i]);
+
+        if(queue.q_errors[i].error_kind != NO_ERROR_KIND){
+            if(!ret){
+                errset(e, queue.q_errors[i].error_kind,
+                        queue.q_errors[i].error_id);
+            }
+
+            ret = 1;
+            continue;
+        }
+
+        finish_die_tree(cus[i]);
+    }
+
+    pthread_mutex_destroy(&queue.q_lock);
+    free(queue.q_errors);
+    free(workers);
+    free(threads);
+
+    return ret;
+}
+
+/* Fill in cu_name, cu_low_pc, cu_high_pc, and cu_hasranges from the
+ * root DIE. If addranges is set, this compilation unit wasn't in
+ * .debug_aranges, so its PC ranges go into the lookup table too.
+ */
+static void read_root_die_attributes(dwarfinfo_t *dwarfinfo,
+        compunit_t *cu, int addranges){
+    Dwarf_Debug dbg = dwarfinfo->di_dbg;
+    Dwarf_Error d_error = NULL;
+    Dwarf_Die root = NULL;
+    int is_info = 1;
+
+    if(cu->cu_rootread)
+        return;
+
+    cu->cu_rootread = 1;
+
+    int ret = dwarf_offdie_b(dbg, cu->cu_die_offset, is_info, &root,
+            &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    if(ret != DW_DLV_OK)
+        return;
+
+    char *name = NULL;
+    ret = dwarf_diename(root, &name, &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    if(ret == DW_DLV_OK){
+        cu->cu_name = strtab_intern(dwarfinfo->di_strtab, name);
+        dwarf_dealloc(dbg, name, DW_DLA_STRING);
+    }
+
+    ret = dwarf_lowpc(root, &cu->cu_low_pc, &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    Dwarf_Half retform = 0;
+    enum Dwarf_Form_Class retformclass = 0;
+    ret = dwarf_highpc_b(root, &cu->cu_high_pc, &retform, &retformclass,
+            &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    /* DWARF 4+ gives high PC as an offset from low PC */
+    if(ret == DW_DLV_OK && retformclass == DW_FORM_CLASS_CONSTANT)
+        cu->cu_high_pc += cu->cu_low_pc;
+
+    if(addranges){
+        read_root_die_ranges(dwarfinfo, cu, root);
+
+        if(!cu->cu_hasranges)
+            add_cu_range(dwarfinfo, cu, cu->cu_low_pc, cu->cu_high_pc);
+    }
+    else{
+        Dwarf_Bool hasranges = 0;
+        ret = dwarf_hasattr(root, DW_AT_ranges, &hasranges, &d_error);
+
+        if(ret == DW_DLV_ERROR)
+            dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+        cu->cu_hasranges = ret == DW_DLV_OK && hasranges;
+    }
+
+    dwarf_dealloc(dbg, root, DW_DLA_DIE);
+}
+
+/* Add every address range in .debug_aranges to the lookup table.
+ * Each one names its compilation unit by root DIE offset, which is
+ * all we need, so none of those root DIEs get read. Sets the
+ * compilation units it saw in seencus.
+ */
+static void read_aranges(dwarfinfo_t *dwarfinfo, struct hashmap *cusbydie,
+        struct hashmap *seencus){
+    Dwarf_Debug dbg = dwarfinfo->di_dbg;
+    Dwarf_Error d_error = NULL;
+    Dwarf_Arange *aranges = NULL;
+    Dwarf_Signed arangescnt = 0;
+
+    int ret = dwarf_get_aranges(dbg, &aranges, &arangescnt, &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    if(ret != DW_DLV_OK)
+        return;
+
+    for(Dwarf_Signed i=0; i<arangescnt; i++){
+        Dwarf_Unsigned segment = 0, segment_entry_size = 0, length = 0;
+        Dwarf_Addr start = 0;
+        Dwarf_Off cu_die_offset = 0;
+
+        ret = dwarf_get_arange_info_b(aranges[i], &segment,
+                &segment_entry_size, &start, &length, &cu_die_offset,
+                &d_error);
+
+        if(ret == DW_DLV_ERROR)
+            dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+        if(ret == DW_DLV_OK){
+            compunit_t *cu = hashmap_get(cusbydie, cu_die_offset);
+
+            if(cu){
+                add_cu_range(dwarfinfo, cu, start, start + length);
+                hashmap_set(seencus, (uintptr_t)cu, cu);
+            }
+        }
+
+        dwarf_dealloc(dbg, aranges[i], DW_DLA_ARANGE);
+    }
+
+    dwarf_dealloc(dbg, aranges, DW_DLA_LIST);
+}
+
+int cu_display_compilation_units(dwarfinfo_t *dwarfinfo, sym_error_t *e){
+    if(!dwarfinfo){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_DWARFINFO);
+        return 1;
+    }
+
+    int cnt = 1;
+
+    LL_FOREACH(dwarfinfo->di_compunits, current){
+        compunit_t *cu = current->data;
+
+        read_root_die_attributes(dwarfinfo, cu, 0);
+
+        printf("Compilation unit %d/%d:\n"
+                "\tcu_header_len: %#llx\n"
+                "\tcu_abbrev_offset: %#llx\n"
+                "\tcu_address_size: %#x\n"
+                "\tcu_next_header_offset: %#llx\n"
+                "\tcu_diename: '%s'\n",
+                cnt++, dwarfinfo->di_numcompunits,
+                cu->cu_header_len, cu->cu_abbrev_offset,
+                cu->cu_address_size, cu->cu_next_header_offset,
+                cu->cu_name);
+    }
+    
+    return 0;
+}
+
+int cu_find_compilation_unit_by_name(dwarfinfo_t *dwarfinfo,
+        compunit_t **cuout, char *name, sym_error_t *e){
+    if(!dwarfinfo){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_DWARFINFO);
+        return 1;
+    }
+
+    if(!name){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_PARAMETER);
+        return 1;
+    }
+
+    LL_FOREACH(dwarfinfo->di_compunits, current){
+        compunit_t *cu = current->data;
+
+        read_root_die_attributes(dwarfinfo, cu, 0);
+
+        if(cu->cu_name && strcmp(cu->cu_name, name) == 0){
+            *cuout = cu;
+            return 0;
+        }
+    }
+
+    errset(e, CU_ERROR_KIND, CU_CU_NOT_FOUND);
+    return 1;
+}
+
+/* cu_find_compilation_unit_by_pc for pcs in ascending order. Each
+ * search starts at the range the last one ended on. NULL for PCs no
+ * compilation unit covers.
+ */
+void cu_find_compilation_units_by_sorted_pcs(dwarfinfo_t *dwarfinfo,
+        const uint64_t *pcs, int n, compunit_t **cusout){
+    struct cu_range *ranges = dwarfinfo->di_curanges;
+    int start = 0;
+
+    for(int i=0; i<n; i++){
+        /* First range that ends after pc */
+        int lo = start, hi = dwarfinfo->di_numcuranges;
+
+        while(lo < hi){
+            int mid = lo + ((hi - lo) / 2);
+
+            if(ranges[mid].cr_high <= pcs[i])
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        start = lo;
+
+        if(lo < dwarfinfo->di_numcuranges && ranges[lo].cr_low <= pcs[i])
+            cusout[i] = ranges[lo].cr_cu;
+        else
+            cusout[i] = NULL;
+    }
+}
+
+int cu_find_compilation_unit_by_pc(dwarfinfo_t *dwarfinfo,
+        compunit_t **cuout, uint64_t pc, sym_error_t *e){
+    if(!dwarfinfo){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_DWARFINFO);
+        return 1;
+    }
+
+    if(!cuout){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_PARAMETER);
+        return 1;
+    }
+
+    struct cu_range *ranges = dwarfinfo->di_curanges;
+    int lo = 0, hi = dwarfinfo->di_numcuranges - 1;
+
+    while(lo <= hi){
+        int mid = lo + ((hi - lo) / 2);
+
+        if(pc < ranges[mid].cr_low)
+            hi = mid - 1;
+        else if(pc >= ranges[mid].cr_high)
+            lo = mid + 1;
+        else{
+            *cuout = ranges[mid].cr_cu;
+            return 0;
+        }
+    }
+
+    errset(e, CU_ERROR_KIND, CU_CU_NOT_FOUND);
+    return 1;
+}
+
+static int is_type_tag(int tag){
+    switch(tag){
+        case DW_TAG_base_type:
+        case DW_TAG_class_type:
+        case DW_TAG_enumeration_type:
+        case DW_TAG_structure_type:
+        case DW_TAG_typedef:
+        case DW_TAG_union_type:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Ask whichever accelerator table covers tag for the .debug_info
+ * offsets name is at. The tables leave out declarations and anything
+ * local, so only functions, variables, and types are looked up.
+ * Returns 1 if no table can answer, or name isn't in it.
+ */
+static int find_in_accel_tables(dwarfinfo_t *dwarfinfo, const char *name,
+        int tag, uint64_t **offsout, int *lenout){
+    int isfxnorvar = tag == DW_TAG_subprogram || tag == DW_TAG_variable;
+
+    if(!isfxnorvar && !is_type_tag(tag))
+        return 1;
+
+    /* Offsets of compilation unit headers */
+    if(dwarfinfo->di_debugnames){
+        return debugnames_find(dwarfinfo->di_debugnames, name, tag,
+                offsout, lenout);
+    }
+
+    /* Offsets of the DIEs themselves */
+    struct appleaccel *ac = isfxnorvar ? dwarfinfo->di_applenames :
+        dwarfinfo->di_appletypes;
+
+    if(ac)
+        return appleaccel_find(ac, name, tag, offsout, lenout);
+
+    if(!dwarfinfo->di_gdbindex)
+        return 1;
+
+    /* Compilation unit indexes, which we turn into header offsets */
+    uint32_t *cuidxs = NULL;
+    int numcuidxs = 0;
+
+    if(gdbindex_find(dwarfinfo->di_gdbindex, name, tag, &cuidxs,
+                &numcuidxs)){
+        return 1;
+    }
+
+    uint64_t *offs = malloc(sizeof(uint64_t) * numcuidxs);
+
+    for(int i=0; i<numcuidxs; i++){
+        uint64_t len;
+        gdbindex_get_cu(dwarfinfo->di_gdbindex, cuidxs[i], &offs[i], &len);
+    }
+
+    free(cuidxs);
+
+    *offsout = offs;
+    *lenout = numcuidxs;
+
+    return 0;
+}
+
+/* Build the DIE trees of the compilation units these .debug_info
+ * offsets fall in.
+ */
+static int build_die_trees_containing(dwarfinfo_t *dwarfinfo,
+        const uint64_t *offs, int numoffs, sym_error_t *e){
+    for(int i=0; i<numoffs; i++){
+        LL_FOREACH(dwarfinfo->di_compunits, current){
+            compunit_t *cu = current->data;
+
+            if(offs[i] < cu->cu_header_offset ||
+                    offs[i] >= cu->cu_next_header_offset){
+                continue;
+            }
+
+            if(!cu->cu_root_die && build_die_tree(cu, e))
+                return 1;
+
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/* Make sure every compilation unit has its DIE tree. Only does anything
+ * when we were loaded lazily.
+ */
+static int build_all_die_trees(dwarfinfo_t *dwarfinfo, sym_error_t *e){
+    LL_FOREACH(dwarfinfo->di_compunits, current){
+        compunit_t *cu = current->data;
+
+        if(!cu->cu_root_die && build_die_tree(cu, e))
+            return 1;
+    }
 
-int cu_display_compilation_units(dwarfinfo_t *dwarfinfo, sym_error_t *e){
-    if(!dwarfinfo){
-        errset(e, GENERIC_ERROR_KIND, GE_INVALID_DWARFINFO);
+    return 0;
+}
+
+int cu_find_die_by_name(compunit_t *cu, const char *name, void **dieout,
+        sym_error_t *e){
+    if(!cu){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_CU_POINTER);
         return 1;
     }
 
-    int cnt = 1;
+    if(!name || !dieout){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_PARAMETER);
+        return 1;
+    }
 
-    LL_FOREACH(dwarfinfo->di_compunits, current){
-        compunit_t *cu = current->data;
+    if(!cu->cu_root_die && build_die_tree(cu, e))
+        return 1;
 
-        char *cuname = NULL;
-        die_get_name(cu->cu_root_die, &cuname, NULL);
+    /* If the name was never interned, nothing has it */
+    const char *interned = strtab_lookup(cu->cu_dwarfinfo->di_strtab, name);
 
-        printf("Compilation unit %d/%d:\n"
-                "\tcu_header_len: %#llx\n"
-                "\tcu_abbrev_offset: %#llx\n"
-                "\tcu_address_size: %#x\n"
-                "\tcu_next_header_offset: %#llx\n"
-                "\tcu_diename: '%s'\n",
-                cnt++, dwarfinfo->di_numcompunits,
-                cu->cu_header_len, cu->cu_abbrev_offset,
-                cu->cu_address_size, cu->cu_next_header_offset,
-                cuname);
+    *dieout = NULL;
+
+    if(interned){
+        *dieout = nameindex_find_in_cu(cu->cu_dwarfinfo->di_nameindex,
+                interned, cu);
     }
-    
+
+    if(!(*dieout)){
+        errset(e, DIE_ERROR_KIND, DIE_DIE_NOT_FOUND);
+        return 1;
+    }
+
     return 0;
 }
 
-int cu_find_compilation_unit_by_name(dwarfinfo_t *dwarfinfo,
-        compunit_t **cuout, char *name, sym_error_t *e){
-    if(!dwarfinfo){
-        errset(e, GENERIC_ERROR_KIND, GE_INVALID_DWARFINFO);
+/* Resolve a .debug_info offset to our DIE. References can point into
+ * other compilation units, so if we haven't built the one the offset
+ * falls in yet, do that first.
+ */
+int cu_find_die_by_offset(compunit_t *cu, Dwarf_Off offset, void **dieout,
+        sym_error_t *e){
+    if(!cu){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_CU_POINTER);
         return 1;
     }
 
-    if(!name){
+    if(!dieout){
         errset(e, GENERIC_ERROR_KIND, GE_INVALID_PARAMETER);
         return 1;
     }
 
+    dwarfinfo_t *dwarfinfo = cu->cu_dwarfinfo;
+
+    *dieout = hashmap_get(dwarfinfo->di_dieoffsets,
+            cu_get_offset_key(cu, offset));
+
+    if(*dieout)
+        return 0;
+
+    /* References out of a split unit never leave its object, and its
+     * tree is built by now.
+     */
+    if(cu->cu_splitdbg){
+        errset(e, DIE_ERROR_KIND, DIE_DIE_NOT_FOUND);
+        return 1;
+    }
+
     LL_FOREACH(dwarfinfo->di_compunits, current){
-        compunit_t *cu = current->data;
+        compunit_t *owner = current->data;
+
+        if(offset < owner->cu_header_offset ||
+                offset >= owner->cu_next_header_offset){
+            continue;
+        }
 
-        char *cuname = NULL;
-        die_get_name(cu->cu_root_die, &cuname, NULL);
+        if(!owner->cu_root_die){
+            if(build_die_tree(owner, e))
+                return 1;
 
-        if(strcmp(cuname, name) == 0){
-            *cuout = cu;
-            return 0;
+            *dieout = hashmap_get(dwarfinfo->di_dieoffsets,
+                    cu_get_offset_key(owner, offset));
         }
+
+        break;
     }
 
-    errset(e, CU_ERROR_KIND, CU_CU_NOT_FOUND);
-    return 1;
+    if(!(*dieout)){
+        errset(e, DIE_ERROR_KIND, DIE_DIE_NOT_FOUND);
+        return 1;
+    }
+
+    return 0;
 }
 
-int cu_find_compilation_unit_by_pc(dwarfinfo_t *dwarfinfo,
-        compunit_t **cuout, uint64_t pc, sym_error_t *e){
+int cu_find_dies_by_name(dwarfinfo_t *dwarfinfo, const char *name, int tag,
+        void ***diesout, void ***cusout, int *lenout, sym_error_t *e){
     if(!dwarfinfo){
         errset(e, GENERIC_ERROR_KIND, GE_INVALID_DWARFINFO);
         return 1;
     }
 
-    if(!cuout){
+    if(!name || !diesout || !cusout || !lenout){
         errset(e, GENERIC_ERROR_KIND, GE_INVALID_PARAMETER);
         return 1;
     }
 
-    LL_FOREACH(dwarfinfo->di_compunits, current){
-        compunit_t *cu = current->data;
+    /* The index only knows about compilation units we've built. The
+     * index cache says which ones have this name, and so do the
+     * accelerator tables for the tags they cover. None of them have
+     * generated names, so anything they don't know means building
+     * everything.
+     */
+    const uint32_t *cuidxs = NULL;
+    uint32_t numcuidxs = 0;
+    uint64_t *offs = NULL;
+    int numoffs = 0;
 
-        Dwarf_Unsigned lpc = 0, hpc = 0;
-        die_get_low_pc(cu->cu_root_die, &lpc, NULL);
-        die_get_high_pc(cu->cu_root_die, &hpc, NULL);
-        
-        if(pc >= lpc && pc < hpc){
-            *cuout = cu;
-            return 0;
+    if(dwarfinfo->di_symcache && !symcache_find_name(dwarfinfo->di_symcache,
+                name, &cuidxs, &numcuidxs)){
+        for(uint32_t i=0; i<numcuidxs; i++){
+            if(cuidxs[i] >= (uint32_t)dwarfinfo->di_numcompunits)
+                continue;
+
+            compunit_t *cu = dwarfinfo->di_symcachecus[cuidxs[i]];
+
+            if(!cu->cu_root_die && build_die_tree(cu, e))
+                return 1;
         }
     }
+    else if(!find_in_accel_tables(dwarfinfo, name, tag, &offs, &numoffs)){
+        int ret = build_die_trees_containing(dwarfinfo, offs, numoffs, e);
 
-    errset(e, CU_ERROR_KIND, CU_CU_NOT_FOUND);
-    return 1;
+        free(offs);
+
+        if(ret)
+            return 1;
+    }
+    else if(build_all_die_trees(dwarfinfo, e)){
+        return 1;
+    }
+
+    const char *interned = strtab_lookup(dwarfinfo->di_strtab, name);
+
+    if(!interned || nameindex_find(dwarfinfo->di_nameindex, interned, tag,
+                diesout, cusout, lenout)){
+        errset(e, DIE_ERROR_KIND, DIE_DIE_NOT_FOUND);
+        return 1;
+    }
+
+    return 0;
 }
 
 int cu_free(compunit_t *cu, sym_error_t *e){
@@ -110,7 +1217,19 @@ int cu_free(compunit_t *cu, sym_error_t *e){
         return 1;
     }
 
-    free(cu->cu_root_die);
+    if(cu->cu_root_die){
+        die_tree_free(cu->cu_dbg, cu->cu_root_die, 0);
+        cu->cu_root_die = NULL;
+    }
+
+    /* The .dwp package is finished in sym_end */
+    if(cu->cu_splitdbg && cu->cu_splitfd >= 0){
+        Dwarf_Error d_error = NULL;
+
+        dwarf_finish(cu->cu_splitdbg, &d_error);
+        close(cu->cu_splitfd);
+    }
+
     free(cu);
 
     return 0;
@@ -127,17 +1246,394 @@ int cu_get_address_size(compunit_t *cu, Dwarf_Half *addrsize,
     return 0;
 }
 
+void *cu_get_strtab(compunit_t *cu){
+    return cu->cu_dwarfinfo->di_strtab;
+}
+
+void *cu_get_typecache(compunit_t *cu){
+    return cu->cu_dwarfinfo->di_typecache;
+}
+
+/* NULL unless SYM_INIT_UNIFY_TYPES was given */
+void *cu_get_typeunify(compunit_t *cu){
+    return cu->cu_dwarfinfo->di_typeunify;
+}
+
 int cu_get_root_die(compunit_t *cu, void **dieout, sym_error_t *e){
     if(!cu){
         errset(e, GENERIC_ERROR_KIND, GE_INVALID_CU_POINTER);
         return 1;
     }
 
+    if(!dieout){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_PARAMETER);
+        return 1;
+    }
+
+    /* Lazily loaded compilation units build their DIE tree the first
+     * time someone asks for it.
+     */
+    if(!cu->cu_root_die && build_die_tree(cu, e))
+        return 1;
+
     *dieout = cu->cu_root_die;
     return 0;
 }
 
+/* Set up compilation units from an index cache file instead of
+ * reading their headers and root DIEs. Returns 1 if there isn't an
+ * up to date one.
+ */
+static int load_from_index_cache(dwarfinfo_t *dwarfinfo,
+        const struct symcache_key *key){
+    char *path = symcache_path(dwarfinfo->di_path);
+
+    if(!path)
+        return 1;
+
+    struct symcache *cache = symcache_open(path, key);
+
+    free(path);
+
+    if(!cache)
+        return 1;
+
+    uint32_t numcus = 0, numranges = 0;
+    const struct symcache_cu *cachedcus = symcache_get_cus(cache, &numcus);
+    const struct symcache_range *cachedranges =
+        symcache_get_ranges(cache, &numranges);
+
+    compunit_t **cus = malloc(sizeof(compunit_t *) * (numcus + 1));
+
+    for(uint32_t i=0; i<numcus; i++){
+        const struct symcache_cu *sc = &cachedcus[i];
+        compunit_t *cu = calloc(1, sizeof(compunit_t));
+
+        cu->cu_dwarfinfo = dwarfinfo;
+        cu->cu_header_offset = sc->sc_header_offset;
+        cu->cu_header_len = sc->sc_header_len;
+        cu->cu_abbrev_offset = sc->sc_abbrev_offset;
+        cu->cu_address_size = sc->sc_address_size;
+        cu->cu_next_header_offset = sc->sc_next_header_offset;
+        cu->cu_die_offset = sc->sc_die_offset;
+        cu->cu_name = strtab_intern(dwarfinfo->di_strtab,
+                symcache_get_string(cache, sc->sc_name));
+        cu->cu_low_pc = sc->sc_low_pc;
+        cu->cu_high_pc = sc->sc_high_pc;
+        cu->cu_hasranges = sc->sc_hasranges;
+        cu->cu_rootread = 1;
+
+        linkedlist_add(dwarfinfo->di_compunits, cu);
+
+        cus[i] = cu;
+    }
+
+    dwarfinfo->di_numcompunits = numcus;
+
+    /* These were finalized before they were written */
+    for(uint32_t i=0; i<numranges; i++){
+        const struct symcache_range *r = &cachedranges[i];
+
+        if(r->sr_cu < numcus)
+            add_cu_range(dwarfinfo, cus[r->sr_cu], r->sr_low, r->sr_high);
+    }
+
+    dwarfinfo->di_symcache = cache;
+    dwarfinfo->di_symcachecus = (void **)cus;
+
+    return 0;
+}
+
+struct cachednames {
+    struct symcache_builder *cn_builder;
+
+    /* Compilation unit to its index in the file, plus one */
+    struct hashmap *cn_cuidxs;
+};
+
+static void add_cached_name(const char *name, void *die, void *cu,
+        void *arg){
+    struct cachednames *cn = arg;
+
+    /* These can come out different next time */
+    if(die_has_generated_name(die))
+        return;
+
+    uint64_t cuidx = (uintptr_t)hashmap_get(cn->cn_cuidxs, (uintptr_t)cu);
+
+    symcache_builder_add_name(cn->cn_builder, name, cuidx - 1);
+}
+
+/* Best effort, if the file can't be written we just parse everything
+ * again next time.
+ */
+static void write_index_cache(dwarfinfo_t *dwarfinfo,
+        const struct symcache_key *key){
+    char *path = symcache_path(dwarfinfo->di_path);
+
+    if(!path)
+        return;
+
+    struct symcache_builder *builder = symcache_builder_new();
+    struct hashmap *cuidxs = hashmap_new();
+    uint64_t idx = 0;
+
+    LL_FOREACH(dwarfinfo->di_compunits, current){
+        compunit_t *cu = current->data;
+        struct symcache_cu sc = {0};
+
+        read_root_die_attributes(dwarfinfo, cu, 0);
+
+        sc.sc_header_offset = cu->cu_header_offset;
+        sc.sc_header_len = cu->cu_header_len;
+        sc.sc_abbrev_offset = cu->cu_abbrev_offset;
+        sc.sc_next_header_offset = cu->cu_next_header_offset;
+        sc.sc_die_offset = cu->cu_die_offset;
+        sc.sc_low_pc = cu->cu_low_pc;
+        sc.sc_high_pc = cu->cu_high_pc;
+        sc.sc_name = symcache_builder_add_string(builder, cu->cu_name);
+        sc.sc_address_size = cu->cu_address_size;
+        sc.sc_hasranges = cu->cu_hasranges;
+
+        symcache_builder_add_cu(builder, &sc);
+
+        hashmap_set(cuidxs, (uintptr_t)cu, (void *)(uintptr_t)++idx);
+    }
+
+    for(int i=0; i<dwarfinfo->di_numcuranges; i++){
+        struct cu_range *r = &dwarfinfo->di_curanges[i];
+        uint64_t cuidx = (uintptr_t)hashmap_get(cuidxs, (uintptr_t)r->cr_cu);
+
+        symcache_builder_add_range(builder, r->cr_low, r->cr_high,
+                cuidx - 1);
+    }
+
+    struct cachednames cn = { builder, cuidxs };
+    nameindex_walk(dwarfinfo->di_nameindex, add_cached_name, &cn);
+
+    symcache_builder_write(builder, path, key);
+
+    symcache_builder_free(builder);
+    hashmap_free(cuidxs);
+    free(path);
+}
+
+/* We parse accelerator tables ourselves, straight out of the mapping */
+static void open_accel_tables(dwarfinfo_t *dwarfinfo){
+    struct objfile *of = dwarfinfo->di_objfile;
+    const unsigned char *sect = NULL, *str = NULL;
+    uint64_t sectsize = 0, strsize = 0;
+
+    if(!of || objfile_get_section(of, ".debug_str", &str, &strsize))
+        return;
+
+    if(!objfile_get_section(of, ".debug_names", &sect, &sectsize)){
+        dwarfinfo->di_debugnames = debugnames_new(sect, sectsize, str,
+                strsize);
+    }
+
+    if(!objfile_get_section(of, ".apple_names", &sect, &sectsize)){
+        dwarfinfo->di_applenames = appleaccel_new(sect, sectsize, str,
+                strsize);
+    }
+
+    if(!objfile_get_section(of, ".apple_types", &sect, &sectsize)){
+        dwarfinfo->di_appletypes = appleaccel_new(sect, sectsize, str,
+                strsize);
+    }
+
+    if(!objfile_get_section(of, ".gdb_index", &sect, &sectsize))
+        dwarfinfo->di_gdbindex = gdbindex_new(sect, sectsize);
+}
+
+static uint64_t read_offset(const unsigned char *p, int offsetsize){
+    if(offsetsize == 8){
+        uint64_t off64;
+        memcpy(&off64, p, sizeof(off64));
+        return off64;
+    }
+
+    uint32_t off32;
+    memcpy(&off32, p, sizeof(off32));
+    return off32;
+}
+
+/* Fill in what dwarf_next_cu_header_d would have for the compilation
+ * unit at off in .debug_info, whose total length .gdb_index gave us.
+ * Returns 1 if that isn't a compilation unit header.
+ */
+static int read_cu_header(const unsigned char *info, uint64_t infosize,
+        uint64_t off, uint64_t len, compunit_t *cu){
+    if(off > infosize || len > infosize - off || len < 4)
+        return 1;
+
+    const unsigned char *start = info + off;
+    const unsigned char *end = start + len;
+    const unsigned char *cur = start;
+
+    uint32_t unitlen32;
+    memcpy(&unitlen32, cur, sizeof(unitlen32));
+    cur += sizeof(unitlen32);
+
+    uint64_t unitlen = unitlen32;
+    int offsetsize = 4;
+
+    if(unitlen32 == 0xffffffff){
+        if(end - cur < 8)
+            return 1;
+
+        memcpy(&unitlen, cur, sizeof(unitlen));
+        cur += sizeof(unitlen);
+        offsetsize = 8;
+    }
+
+    /* A stale index */
+    if(unitlen != (uint64_t)(end - cur))
+        return 1;
+
+    if(end - cur < 2)
+        return 1;
+
+    uint16_t version;
+    memcpy(&version, cur, sizeof(version));
+    cur += sizeof(version);
+
+    uint64_t abbrevoff = 0;
+    uint8_t addrsize = 0;
+
+    if(version >= 5){
+        /* Unit type, address size, abbreviation offset, and maybe
+         * a DWO id.
+         */
+        if(end - cur < 2 + offsetsize)
+            return 1;
+
+        uint8_t unittype = *cur++;
+        addrsize = *cur++;
+        abbrevoff = read_offset(cur, offsetsize);
+        cur += offsetsize;
+
+        if(unittype == DW_UT_skeleton || unittype == DW_UT_split_compile){
+            if(end - cur < 8)
+                return 1;
+
+            cur += 8;
+        }
+        else if(unittype != DW_UT_compile && unittype != DW_UT_partial){
+            return 1;
+        }
+    }
+    else if(version >= 2){
+        if(end - cur < offsetsize + 1)
+            return 1;
+
+        abbrevoff = read_offset(cur, offsetsize);
+        cur += offsetsize;
+        addrsize = *cur++;
+    }
+    else{
+        return 1;
+    }
+
+    cu->cu_header_offset = off;
+    cu->cu_header_len = unitlen;
+    cu->cu_abbrev_offset = abbrevoff;
+    cu->cu_address_size = addrsize;
+    cu->cu_next_header_offset = off + len;
+    cu->cu_die_offset = off + (cur - start);
+
+    return 0;
+}
+
+/* Set up compilation units and their PC ranges from .gdb_index instead
+ * of reading .debug_info. Only each compilation unit's header is read.
+ * Returns 1 if there's no index or it doesn't match .debug_info.
+ */
+static int load_from_gdb_index(dwarfinfo_t *dwarfinfo){
+    struct gdbindex *gi = dwarfinfo->di_gdbindex;
+    const unsigned char *info = NULL;
+    uint64_t infosize = 0;
+
+    if(!gi || objfile_get_section(dwarfinfo->di_objfile, ".debug_info",
+                &info, &infosize)){
+        return 1;
+    }
+
+    uint32_t numcus = gdbindex_get_numcus(gi);
+
+    if(numcus == 0)
+        return 1;
+
+    compunit_t **cus = calloc(numcus, sizeof(compunit_t *));
+
+    for(uint32_t i=0; i<numcus; i++){
+        uint64_t off, len;
+        gdbindex_get_cu(gi, i, &off, &len);
+
+        cus[i] = calloc(1, sizeof(compunit_t));
+        cus[i]->cu_dwarfinfo = dwarfinfo;
+
+        if(read_cu_header(info, infosize, off, len, cus[i])){
+            for(uint32_t k=0; k<=i; k++)
+                free(cus[k]);
+
+            free(cus);
+
+            return 1;
+        }
+    }
+
+    for(uint32_t i=0; i<numcus; i++)
+        linkedlist_add(dwarfinfo->di_compunits, cus[i]);
+
+    dwarfinfo->di_numcompunits = numcus;
+
+    uint32_t numaddrs = gdbindex_get_numaddrs(gi);
+
+    for(uint32_t i=0; i<numaddrs; i++){
+        uint64_t low, high;
+        uint32_t cuidx;
+        gdbindex_get_addr(gi, i, &low, &high, &cuidx);
+
+        if(cuidx < numcus)
+            add_cu_range(dwarfinfo, cus[cuidx], low, high);
+    }
+
+    finalize_cu_ranges(dwarfinfo);
+
+    free(cus);
+
+    return 0;
+}
+
 int cu_load_compilation_units(dwarfinfo_t *dwarfinfo, sym_error_t *e){
+    open_accel_tables(dwarfinfo);
+
+    struct symcache_key key;
+    int usecache = (dwarfinfo->di_flags & SYM_INIT_INDEX_CACHE) &&
+        !symcache_compute_key(dwarfinfo->di_fd, &key);
+
+    /* Everything else is built lazily */
+    if(usecache && !load_from_index_cache(dwarfinfo, &key))
+        return 0;
+
+    /* Same here, unless the index cache needs writing. Without
+     * SYM_INIT_LAZY every tree gets built anyway, so that goes
+     * through .debug_info like it always has.
+     */
+    if((dwarfinfo->di_flags & SYM_INIT_LAZY) && !usecache &&
+            !load_from_gdb_index(dwarfinfo)){
+        return 0;
+    }
+
+    /* The first header is at the start of .debug_info, every other
+     * one follows the previous compilation unit.
+     */
+    Dwarf_Unsigned header_offset = 0;
+
+    /* Root DIE offset to its compilation unit, for .debug_aranges */
+    struct hashmap *cusbydie = hashmap_new();
+
     for(;;){
         compunit_t *cu = calloc(1, sizeof(compunit_t));
         Dwarf_Half ver, len_sz, ext_sz, hdr_type;
@@ -156,26 +1652,92 @@ int cu_load_compilation_units(dwarfinfo_t *dwarfinfo, sym_error_t *e){
             dwarf_dealloc(dwarfinfo->di_dbg, d_error, DW_DLA_ERROR);
             errset(e, CU_ERROR_KIND, CU_DWARF_NEXT_CU_HEADER_D_FAILED);
             free(cu);
+            hashmap_free(cusbydie);
             return 1;
         }
 
         if(ret == DW_DLV_NO_ENTRY){
             free(cu);
-            return 0;
+            break;
         }
 
-        void *root_die = NULL;
-        if(initialize_and_build_die_tree_from_root_die(dwarfinfo, cu,
-                &root_die, e)){
+        cu->cu_dwarfinfo = dwarfinfo;
+        cu->cu_header_offset = header_offset;
+        header_offset = cu->cu_next_header_offset;
+
+        ret = dwarf_get_cu_die_offset_given_cu_header_offset_b(
+                dwarfinfo->di_dbg, cu->cu_header_offset, is_info,
+                &cu->cu_die_offset, &d_error);
+
+        if(ret != DW_DLV_OK){
+            if(ret == DW_DLV_ERROR)
+                dwarf_dealloc(dwarfinfo->di_dbg, d_error, DW_DLA_ERROR);
+
+            errset(e, CU_ERROR_KIND, CU_DWARF_GET_CU_DIE_OFFSET_FAILED);
             free(cu);
+            hashmap_free(cusbydie);
             return 1;
         }
 
-        cu->cu_root_die = root_die;
+        hashmap_set(cusbydie, cu->cu_die_offset, cu);
+
         linkedlist_add(dwarfinfo->di_compunits, cu);
 
         dwarfinfo->di_numcompunits++;
     }
 
+    /* Compilation units .debug_aranges doesn't cover, or every one
+     * of them if there's no .debug_aranges, get their ranges from
+     * the root DIE.
+     */
+    struct hashmap *seencus = hashmap_new();
+
+    read_aranges(dwarfinfo, cusbydie, seencus);
+
+    LL_FOREACH(dwarfinfo->di_compunits, current){
+        compunit_t *cu = current->data;
+
+        if(!hashmap_get(seencus, (uintptr_t)cu))
+            read_root_die_attributes(dwarfinfo, cu, 1);
+    }
+
+    hashmap_free(cusbydie);
+    hashmap_free(seencus);
+
+    finalize_cu_ranges(dwarfinfo);
+
+    /* The index cache needs every tree to know where names are */
+    if((dwarfinfo->di_flags & SYM_INIT_LAZY) && !usecache)
+        return 0;
+
+    /* Which compilation unit owns a unified type would depend on which
+     * worker got there first, so unifying builds one at a time.
+     */
+    if((dwarfinfo->di_flags & SYM_INIT_PARALLEL) &&
+            !(dwarfinfo->di_flags & SYM_INIT_UNIFY_TYPES)){
+        compunit_t **cus = malloc(sizeof(compunit_t *) *
+                (dwarfinfo->di_numcompunits + 1));
+        int idx = 0;
+
+        LL_FOREACH(dwarfinfo->di_compunits, current)
+            cus[idx++] = current->data;
+
+        int ret = build_die_trees_in_parallel(dwarfinfo, cus, idx, e);
+
+        free(cus);
+
+        if(ret)
+            return 1;
+    }
+    else{
+        LL_FOREACH(dwarfinfo->di_compunits, current){
+            if(build_die_tree(current->data, e))
+                return 1;
+        }
+    }
+
+    if(usecache)
+        write_index_cache(dwarfinfo, &key);
+
     return 0;
 }
@@ -4,9 +4,19 @@
 int cu_display_compilation_units(void *, void *);
 int cu_find_compilation_unit_by_name(void *, void **, char *, void *);
 int cu_find_compilation_unit_by_pc(void *, void **, uint64_t, void *);
+void cu_find_compilation_units_by_sorted_pcs(void *, const uint64_t *, int,
+        void **);
+int cu_find_die_by_name(void *, const char *, void **, void *);
+int cu_find_die_by_offset(void *, Dwarf_Off, void **, void *);
+int cu_find_dies_by_name(void *, const char *, int, void ***, void ***, int *,
+        void *);
 int cu_free(void *, void *);
 int cu_get_address_size(void *, unsigned short *, void *);
+uint64_t cu_get_offset_key(void *, Dwarf_Off);
 int cu_get_root_die(void *, void **, void *);
+void *cu_get_strtab(void *);
+void *cu_get_typecache(void *);
+void *cu_get_typeunify(void *);
 int cu_load_compilation_units(void *, void *); 
 
 #endif
@@ -0,0 +1,537 @@
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dwarf.h>
+
+#include "hashmap.h"
+#include "debugnames.h"
+
+/* A DWARF 5 .debug_names section is one or more name indexes, each
+ * laid out as:
+ *
+ *      header
+ *      compilation unit offsets    offset[cu_count]
+ *      local type unit offsets     offset[local_tu_count]
+ *      foreign type unit sigs      uint64_t[foreign_tu_count]
+ *      hash buckets                uint32_t[bucket_count]
+ *      hashes                      uint32_t[name_count], if buckets
+ *      .debug_str offsets          offset[name_count]
+ *      entry pool offsets          offset[name_count]
+ *      abbreviations               abbrev_table_size bytes
+ *      entry pool
+ *
+ * Every name's entries are a run of abbreviation codes, each followed
+ * by the attribute values its abbreviation describes, ended by a zero
+ * code. We only want which compilation units a name is in, so nothing
+ * here ever reads a DIE.
+ *
+ * We only see sections through objfile.c, which only takes files in
+ * our byte order, so multi byte values are read as is.
+ */
+
+struct dnattr {
+    uint64_t da_idx;
+    uint64_t da_form;
+};
+
+struct dnabbrev {
+    uint64_t dab_tag;
+    int dab_numattrs;
+    struct dnattr *dab_attrs;
+};
+
+struct dnindex {
+    /* 4 for 32 bit DWARF, 8 for 64 bit */
+    int dn_offsetsize;
+
+    const unsigned char *dn_cuoffs;
+    uint32_t dn_cucount;
+
+    uint32_t dn_bucketcount;
+    uint32_t dn_namecount;
+    const unsigned char *dn_buckets;
+    const unsigned char *dn_hashes;
+    const unsigned char *dn_stroffs;
+    const unsigned char *dn_entryoffs;
+
+    /* Abbreviation code to struct dnabbrev */
+    struct hashmap *dn_abbrevs;
+
+    const unsigned char *dn_entrypool;
+    uint64_t dn_entrypoolsize;
+};
+
+struct debugnames {
+    struct dnindex *dns_indexes;
+    int dns_numindexes;
+
+    /* .debug_str, where every name lives */
+    const unsigned char *dns_str;
+    uint64_t dns_strsize;
+};
+
+struct cursor {
+    const unsigned char *c_cur;
+    const unsigned char *c_end;
+
+    /* Set once we've tried to read past c_end */
+    int c_bad;
+};
+
+static uint64_t read_fixed(struct cursor *c, int size){
+    if(c->c_bad || c->c_end - c->c_cur < size){
+        c->c_bad = 1;
+        return 0;
+    }
+
+    uint64_t val = 0;
+
+    if(size == 1)
+        val = *c->c_cur;
+    else if(size == 2){
+        uint16_t v16;
+        memcpy(&v16, c->c_cur, sizeof(v16));
+        val = v16;
+    }
+    else if(size == 4){
+        uint32_t v32;
+        memcpy(&v32, c->c_cur, sizeof(v32));
+        val = v32;
+    }
+    else if(size == 8)
+        memcpy(&val, c->c_cur, sizeof(val));
+
+    c->c_cur += size;
+
+    return val;
+}
+
+static uint64_t read_uleb(struct cursor *c){
+    uint64_t val = 0;
+    int shift = 0;
+
+    while(!c->c_bad){
+        if(c->c_cur >= c->c_end){
+            c->c_bad = 1;
+            break;
+        }
+
+        unsigned char byte = *c->c_cur++;
+
+        if(shift < 64)
+            val |= (uint64_t)(byte & 0x7f) << shift;
+
+        shift += 7;
+
+        if(!(byte & 0x80))
+            break;
+    }
+
+    return val;
+}
+
+static void skip(struct cursor *c, uint64_t size){
+    if(c->c_bad || (uint64_t)(c->c_end - c->c_cur) < size){
+        c->c_bad = 1;
+        return;
+    }
+
+    c->c_cur += size;
+}
+
+/* Entry pool values only come in a few forms. Returns 1 for one we
+ * don't know the size of, the rest of that entry can't be read.
+ */
+static int read_form(struct cursor *c, uint64_t form, uint64_t *valout){
+    *valout = 0;
+
+    switch(form){
+        case DW_FORM_flag_present:
+            *valout = 1;
+            break;
+        case DW_FORM_data1:
+        case DW_FORM_ref1:
+        case DW_FORM_flag:
+            *valout = read_fixed(c, 1);
+            break;
+        case DW_FORM_data2:
+        case DW_FORM_ref2:
+            *valout = read_fixed(c, 2);
+            break;
+        case DW_FORM_data4:
+        case DW_FORM_ref4:
+            *valout = read_fixed(c, 4);
+            break;
+        case DW_FORM_data8:
+        case DW_FORM_ref8:
+        case DW_FORM_ref_sig8:
+            *valout = read_fixed(c, 8);
+            break;
+        case DW_FORM_data16:
+            skip(c, 16);
+            break;
+        /* Same size as an unsigned one, and never a unit index */
+        case DW_FORM_sdata:
+        case DW_FORM_udata:
+        case DW_FORM_ref_udata:
+            *valout = read_uleb(c);
+            break;
+        default:
+            return 1;
+    }
+
+    return c->c_bad;
+}
+
+static void free_abbrevs(struct hashmap *abbrevs){
+    if(!abbrevs)
+        return;
+
+    for(uint64_t i=0; i<abbrevs->capacity; i++){
+        struct hashmap_entry *entry = &abbrevs->entries[i];
+
+        if(!entry->used)
+            continue;
+
+        struct dnabbrev *abbrev = entry->value;
+
+        free(abbrev->dab_attrs);
+        free(abbrev);
+    }
+
+    hashmap_free(abbrevs);
+}
+
+static int parse_abbrevs(struct dnindex *dn, struct cursor c){
+    dn->dn_abbrevs = hashmap_new();
+
+    for(;;){
+        uint64_t code = read_uleb(&c);
+
+        if(c.c_bad)
+            return 1;
+
+        if(code == 0)
+            return 0;
+
+        if(hashmap_get(dn->dn_abbrevs, code))
+            return 1;
+
+        struct dnabbrev *abbrev = calloc(1, sizeof(struct dnabbrev));
+        abbrev->dab_tag = read_uleb(&c);
+
+        hashmap_set(dn->dn_abbrevs, code, abbrev);
+
+        int cap = 0;
+
+        for(;;){
+            uint64_t idx = read_uleb(&c);
+            uint64_t form = read_uleb(&c);
+
+            if(c.c_bad)
+                return 1;
+
+            if(idx == 0 && form == 0)
+                break;
+
+            if(abbrev->dab_numattrs == cap){
+                cap = cap ? cap * 2 : 4;
+
+                struct dnattr *attrs_rea = realloc(abbrev->dab_attrs,
+                        sizeof(struct dnattr) * cap);
+                abbrev->dab_attrs = attrs_rea;
+            }
+
+            struct dnattr *attr = &abbrev->dab_attrs[abbrev->dab_numattrs++];
+            attr->da_idx = idx;
+            attr->da_form = form;
+        }
+    }
+}
+
+/* Parse the name index starting at c, leaves c at the next one.
+ * Returns 1 if it isn't one we can use.
+ */
+static int parse_index(struct dnindex *dn, struct cursor *c){
+    uint64_t unitlen = read_fixed(c, 4);
+    dn->dn_offsetsize = 4;
+
+    if(unitlen == 0xffffffff){
+        unitlen = read_fixed(c, 8);
+        dn->dn_offsetsize = 8;
+    }
+
+    if(c->c_bad || unitlen > (uint64_t)(c->c_end - c->c_cur)){
+        c->c_bad = 1;
+        return 1;
+    }
+
+    struct cursor unit = { c->c_cur, c->c_cur + unitlen, 0 };
+    c->c_cur += unitlen;
+
+    uint64_t version = read_fixed(&unit, 2);
+    /* Padding */
+    read_fixed(&unit, 2);
+
+    dn->dn_cucount = read_fixed(&unit, 4);
+    uint32_t localtucount = read_fixed(&unit, 4);
+    uint32_t foreigntucount = read_fixed(&unit, 4);
+    dn->dn_bucketcount = read_fixed(&unit, 4);
+    dn->dn_namecount = read_fixed(&unit, 4);
+    uint32_t abbrevsize = read_fixed(&unit, 4);
+    uint32_t augsize = read_fixed(&unit, 4);
+
+    if(unit.c_bad || version != 5)
+        return 1;
+
+    skip(&unit, augsize);
+
+    int osz = dn->dn_offsetsize;
+
+    dn->dn_cuoffs = unit.c_cur;
+    skip(&unit, (uint64_t)dn->dn_cucount * osz);
+    skip(&unit, (uint64_t)localtucount * osz);
+    skip(&unit, (uint64_t)foreigntucount * 8);
+
+    dn->dn_buckets = unit.c_cur;
+    skip(&unit, (uint64_t)dn->dn_bucketcount * 4);
+
+    dn->dn_hashes = unit.c_cur;
+
+    if(dn->dn_bucketcount)
+        skip(&unit, (uint64_t)dn->dn_namecount * 4);
+
+    dn->dn_stroffs = unit.c_cur;
+    skip(&unit, (uint64_t)dn->dn_namecount * osz);
+
+    dn->dn_entryoffs = unit.c_cur;
+    skip(&unit, (uint64_t)dn->dn_namecount * osz);
+
+    struct cursor abbrevs = { unit.c_cur, unit.c_cur + abbrevsize, 0 };
+    skip(&unit, abbrevsize);
+
+    if(unit.c_bad)
+        return 1;
+
+    dn->dn_entrypool = unit.c_cur;
+    dn->dn_entrypoolsize = unit.c_end - unit.c_cur;
+
+    return parse_abbrevs(dn, abbrevs);
+}
+
+/* Returns NULL if .debug_names is empty or isn't something we can
+ * read, callers should use their own index instead. Nothing is copied,
+ * both sections have to outlive the returned table.
+ */
+struct debugnames *debugnames_new(const unsigned char *names,
+        uint64_t namessize, const unsigned char *str, uint64_t strsize){
+    if(!names || namessize == 0 || !str)
+        return NULL;
+
+    struct debugnames *dns = calloc(1, sizeof(struct debugnames));
+    dns->dns_str = str;
+    dns->dns_strsize = strsize;
+
+    struct cursor c = { names, names + namessize, 0 };
+    int cap = 0;
+
+    while(c.c_cur < c.c_end){
+        if(dns->dns_numindexes == cap){
+            cap = cap ? cap * 2 : 4;
+
+            struct dnindex *indexes_rea = realloc(dns->dns_indexes,
+                    sizeof(struct dnindex) * cap);
+            dns->dns_indexes = indexes_rea;
+        }
+
+        struct dnindex *dn = &dns->dns_indexes[dns->dns_numindexes++];
+        memset(dn, 0, sizeof(struct dnindex));
+
+        /* One bad index means we can't trust any of them to have
+         * every name.
+         */
+        if(parse_index(dn, &c)){
+            debugnames_free(dns);
+            return NULL;
+        }
+    }
+
+    if(dns->dns_numindexes == 0){
+        debugnames_free(dns);
+        return NULL;
+    }
+
+    return dns;
+}
+
+void debugnames_free(struct debugnames *dns){
+    if(!dns)
+        return;
+
+    for(int i=0; i<dns->dns_numindexes; i++)
+        free_abbrevs(dns->dns_indexes[i].dn_abbrevs);
+
+    free(dns->dns_indexes);
+    free(dns);
+}
+
+/* DWARF 5 hashes names with Bernstein's hash after case folding them.
+ * We only fold ASCII, so a name with anything else in it may hash
+ * differently than the producer's and not be found.
+ */
+static uint32_t debugnames_hash(const char *name){
+    uint32_t hash = 5381;
+
+    for(const unsigned char *p=(const unsigned char *)name; *p; p++)
+        hash = (hash * 33) + (uint32_t)tolower(*p);
+
+    return hash;
+}
+
+static uint64_t read_at(const unsigned char *base, uint64_t idx, int size){
+    struct cursor c = { base + (idx * size), base + ((idx + 1) * size), 0 };
+
+    return read_fixed(&c, size);
+}
+
+static int name_matches(struct debugnames *dns, struct dnindex *dn,
+        uint32_t nameidx, const char *name){
+    uint64_t stroff = read_at(dn->dn_stroffs, nameidx, dn->dn_offsetsize);
+
+    if(stroff >= dns->dns_strsize)
+        return 0;
+
+    const char *str = (const char *)dns->dns_str + stroff;
+    size_t maxlen = dns->dns_strsize - stroff;
+    size_t namelen = strlen(name);
+
+    return namelen < maxlen && memcmp(str, name, namelen + 1) == 0;
+}
+
+static void add_cuoff(uint64_t **cuoffs, int *len, int *cap, uint64_t off){
+    for(int i=0; i<*len; i++){
+        if((*cuoffs)[i] == off)
+            return;
+    }
+
+    if(*len == *cap){
+        *cap = *cap ? *cap * 2 : 8;
+
+        uint64_t *cuoffs_rea = realloc(*cuoffs, sizeof(uint64_t) * *cap);
+        *cuoffs = cuoffs_rea;
+    }
+
+    (*cuoffs)[(*len)++] = off;
+}
+
+/* Add the compilation unit of every entry of name nameidx with a
+ * matching tag. Entries in type units are skipped, we don't load those.
+ */
+static void add_entries(struct dnindex *dn, uint32_t nameidx, int tag,
+        uint64_t **cuoffs, int *len, int *cap){
+    uint64_t entryoff = read_at(dn->dn_entryoffs, nameidx,
+            dn->dn_offsetsize);
+
+    if(entryoff >= dn->dn_entrypoolsize)
+        return;
+
+    struct cursor c = { dn->dn_entrypool + entryoff,
+        dn->dn_entrypool + dn->dn_entrypoolsize, 0 };
+
+    for(;;){
+        uint64_t code = read_uleb(&c);
+
+        if(c.c_bad || code == 0)
+            return;
+
+        struct dnabbrev *abbrev = hashmap_get(dn->dn_abbrevs, code);
+
+        if(!abbrev)
+            return;
+
+        /* With only one compilation unit, entries don't have to
+         * say which one they're in.
+         */
+        uint64_t cuidx = 0;
+        int intu = 0;
+
+        for(int i=0; i<abbrev->dab_numattrs; i++){
+            struct dnattr *attr = &abbrev->dab_attrs[i];
+            uint64_t val;
+
+            if(read_form(&c, attr->da_form, &val))
+                return;
+
+            if(attr->da_idx == DW_IDX_compile_unit)
+                cuidx = val;
+            else if(attr->da_idx == DW_IDX_type_unit)
+                intu = 1;
+        }
+
+        if(intu || cuidx >= dn->dn_cucount)
+            continue;
+
+        if(tag != 0 && abbrev->dab_tag != (uint64_t)tag)
+            continue;
+
+        add_cuoff(cuoffs, len, cap, read_at(dn->dn_cuoffs, cuidx,
+                    dn->dn_offsetsize));
+    }
+}
+
+/* Find the .debug_info offsets of the compilation unit headers that
+ * have an entry for name with tag, any tag if tag is 0. The array
+ * must be freed. Returns 1 if there aren't any.
+ */
+int debugnames_find(struct debugnames *dns, const char *name, int tag,
+        uint64_t **cuoffsout, int *lenout){
+    uint64_t *cuoffs = NULL;
+    int len = 0, cap = 0;
+    uint32_t hash = debugnames_hash(name);
+
+    for(int i=0; i<dns->dns_numindexes; i++){
+        struct dnindex *dn = &dns->dns_indexes[i];
+
+        /* Producers can leave out the hash table */
+        if(dn->dn_bucketcount == 0){
+            for(uint32_t k=0; k<dn->dn_namecount; k++){
+                if(name_matches(dns, dn, k, name))
+                    add_entries(dn, k, tag, &cuoffs, &len, &cap);
+            }
+
+            continue;
+        }
+
+        uint32_t bucket = hash % dn->dn_bucketcount;
+
+        /* Buckets hold the one based index of their first name, and
+         * names in the same bucket are next to each other.
+         */
+        uint64_t first = read_at(dn->dn_buckets, bucket, 4);
+
+        if(first == 0)
+            continue;
+
+        for(uint64_t k=first-1; k<dn->dn_namecount; k++){
+            uint32_t namehash = read_at(dn->dn_hashes, k, 4);
+
+            if(namehash % dn->dn_bucketcount != bucket)
+                break;
+
+            if(namehash == hash && name_matches(dns, dn, k, name))
+                add_entries(dn, k, tag, &cuoffs, &len, &cap);
+        }
+    }
+
+    if(len == 0){
+        free(cuoffs);
+        return 1;
+    }
+
+    *cuoffsout = cuoffs;
+    *lenout = len;
+
+    return 0;
+}
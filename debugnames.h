@@ -0,0 +1,14 @@
+#ifndef _DEBUGNAMES_H_
+#define _DEBUGNAMES_H_
+
+#include <stdint.h>
+
+struct debugnames;
+
+int debugnames_find(struct debugnames *, const char *, int, uint64_t **,
+        int *);
+void debugnames_free(struct debugnames *);
+struct debugnames *debugnames_new(const unsigned char *, uint64_t,
+        const unsigned char *, uint64_t);
+
+#endif
@@ -1,3 +1,4 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,11 +6,19 @@
 #include <dwarf.h>
 #include <libdwarf.h>
 
+#include "arena.h"
 #include "common.h"
 #include "compunit.h"
 #include "dexpr.h"
+#include "hashmap.h"
+#include "linetable.h"
+#include "nameindex.h"
 #include "str.h"
+#include "strtab.h"
 #include "symerr.h"
+#include "sympcinfo.h"
+#include "typecache.h"
+#include "typeunify.h"
 
 typedef struct die die_t;
 
@@ -23,92 +32,224 @@ enum {
 
 #define ARR_DIM_SZ_UNKNOWN ((unsigned)-1)
 
+/* Compilation units usually have hundreds of DIEs at least */
+#define DIE_ARENA_CHUNK_SIZE (64 * 1024)
+
 struct arrdim {
     unsigned int dim;
     unsigned int sz;
 };
 
-struct die {
-    Dwarf_Die die_dwarfdie;
-    Dwarf_Unsigned die_dieoffset;
+/* Every DW_TAG_subprogram in a compilation unit, or every PC range of
+ * every DW_TAG_inlined_subroutine, sorted by low PC. Ties are broken
+ * by putting the bigger range first, so a range's enclosing ranges
+ * always come before it.
+ */
+struct fxnrange {
+    Dwarf_Unsigned fr_low;
+    Dwarf_Unsigned fr_high;
 
-    /* If this DIE represents a compilation unit, the following
-     * two are non-NULL.
-     */
-    Dwarf_Line *die_srclines;
-    Dwarf_Signed die_srclinescnt;
+    /* Index of the innermost range which contains this one, or -1 */
+    int fr_parent;
 
-    Dwarf_Half die_tag;
-    char *die_tagname;
+    die_t *fr_die;
+};
 
-    /* If this DIE represents an anonymous type. */
-    int die_anon;
+struct fxnindex {
+    struct fxnrange *fi_ranges;
+    int fi_len;
+};
 
-    /* If this DIE represents a lexical block. */
-    int die_lexblock;
+/* What a variable, parameter, member, or function's DW_AT_type
+ * resolves to. Every DIE with the same DW_AT_type shares one of these
+ * from the dwarfinfo's type cache. DIEs without a type share
+ * NO_TYPEINFO.
+ */
+struct die_typeinfo {
+    Dwarf_Unsigned ti_datatypedieoffset;
+    Dwarf_Unsigned ti_basedatatypedieoffset;
+    Dwarf_Half ti_datatypedietag;
+    /* DW_ATE_* */
+    Dwarf_Half ti_datatypeencoding;
+    /* High level data type classification. Really, we are only interested
+     * in if this data type DIE represents a pointer, struct, union,
+     * array, or base type.
+     */
+    unsigned int ti_datatypeclass;
+    Dwarf_Unsigned ti_databytessize;
+    const char *ti_datatypename;
+    /* If we have an array, we need to know the size of each element,
+     * not just the overall size of the array.
+     */
+    Dwarf_Unsigned ti_arrmembsz;
+    /* Array of array dimensions */
+    struct arrdim *ti_arrdims;
+    int ti_arrdimslen;
+};
 
-    char *die_diename;
+/* Location lists and frame base. DIEs without either share NO_LOCINFO. */
+struct die_locinfo {
+    Dwarf_Unsigned li_loclistcnt;
 
-    Dwarf_Half die_haschildren;
+    /* Will have li_loclistcnt elements */
+    void **li_loclists;
 
-    /* non-NULL when this die is a parent */
-    /* NULL terminated array of children */
-    die_t **die_children;
-    int die_numchildren;
+    /* Frame base of this subprogram or the one enclosing this DIE.
+     * Only the subprogram's DIE owns it.
+     */
+    void *li_framebase;
+};
 
-    /* non-NULL when this die is a child */
-    die_t *die_parent;
+struct inlinerange {
+    Dwarf_Unsigned ir_low;
+    Dwarf_Unsigned ir_high;
+};
 
-    /* If this DIE describes any sort of variable/parameter in the
-     * debugged program, the following ten are initialized.
+/* Only inlined subroutine DIEs have this */
+struct die_inlineinfo {
+    Dwarf_Unsigned ii_aboriginoff;
+
+    /* Where this was inlined. ii_callfile indexes the line program's
+     * file names, see inline_call_file.
      */
-    Dwarf_Unsigned die_datatypedieoffset;
-    Dwarf_Unsigned die_basedatatypedieoffset;
-    Dwarf_Die die_datatypedie;
-    Dwarf_Half die_datatypedietag;
-    /* DW_ATE_* */
-    Dwarf_Half die_datatypeencoding;
-    Dwarf_Unsigned die_databytessize;
-    char *die_datatypename;
-    /* If we have an array, we need to know the size of each element,
-     * not just the overall size of the array.
+    Dwarf_Unsigned ii_callfile;
+    Dwarf_Unsigned ii_callline;
+
+    /* From DW_AT_ranges, for inlined code that isn't contiguous.
+     * Otherwise the DIE's low and high PC are its only range.
      */
-    Dwarf_Unsigned die_arrmembsz;
-    /* Array of array dimensions */
-    struct arrdim **die_arrdims;
-    int die_arrdimslen;
-    /* High level data type classification. Really, we are only interested
-     * in if this data type DIE represents a pointer, struct, union,
-     * array, or base type.
+    struct inlinerange *ii_ranges;
+    int ii_numranges;
+};
+
+/* Only compilation unit DIEs have this */
+struct die_unitinfo {
+    /* This compilation unit's decoded line table */
+    void *ui_linetable;
+
+    struct fxnindex *ui_fxnindex;
+    struct fxnindex *ui_inlineindex;
+
+    /* The line program's file names, interned, for DW_AT_call_file.
+     * DWARF 5 numbers them from 0, earlier versions from 1.
      */
-    unsigned int die_datatypeclass : 5;
+    const char **ui_srcfiles;
+    int ui_numsrcfiles;
+    Dwarf_Half ui_version;
 
-    /* If this DIE represents an inlined subroutine, the following
-     * two are initialized.
+    /* Every die_t, type description, etc in this tree comes
+     * from here. Names are interned in the dwarfinfo's strtab.
      */
-    int die_inlinedsub;
-    Dwarf_Unsigned die_aboriginoff;
+    struct arena *ui_arena;
+};
+
+/* A compilation unit's DIEs are in one array, in breadth first order,
+ * so every DIE's children are next to each other. Anything that isn't
+ * needed to walk the tree is kept to the side.
+ */
+struct die {
+    Dwarf_Unsigned die_dieoffset;
+
+    const char *die_diename;
 
     /* Where a subroutine, lexical block, etc starts and ends */
     Dwarf_Unsigned die_low_pc;
     Dwarf_Unsigned die_high_pc;
 
+    /* non-NULL when this die is a child */
+    die_t *die_parent;
+
+    /* die_numchildren DIEs starting here */
+    die_t *die_children;
+    uint32_t die_numchildren;
+
+    Dwarf_Half die_tag;
+
+    unsigned int die_haschildren : 1;
+
+    /* If this DIE represents an anonymous type. */
+    unsigned int die_anon : 1;
+
+    /* If this DIE represents a lexical block. */
+    unsigned int die_lexblock : 1;
+
+    /* If this DIE represents an inlined subroutine. */
+    unsigned int die_inlinedsub : 1;
+
+    /* If die_children belong to an identical type, see unify_types */
+    unsigned int die_sharedchildren : 1;
+
     /* Where a member is in a structure, union, etc */
     Dwarf_Unsigned die_memb_off;
 
-    /* If this DIE has the attribute DW_AT_location, the following
-     * two are initialized.
-     */
-    Dwarf_Unsigned die_loclistcnt;
+    const struct die_typeinfo *die_type;
+    const struct die_locinfo *die_loc;
+
+    union {
+        /* Inlined subroutine DIEs */
+        const struct die_inlineinfo *die_inline;
+
+        /* Compilation unit DIEs */
+        struct die_unitinfo *die_unit;
+    };
+};
+
+static const struct die_typeinfo NO_TYPEINFO;
+static const struct die_locinfo NO_LOCINFO;
 
-    /* Will have die_loclistcnt elements */
-    void **die_loclists;
+static struct die_unitinfo *get_unitinfo(die_t *die){
+    /* Only root DIEs have one */
+    if(die->die_parent)
+        return NULL;
+
+    return die->die_unit;
+}
+
+/* Whether die is the root of a unit with a line table. dwz moves what
+ * compilation units share into partial units. A skeleton unit is the
+ * root when its split object couldn't be found.
+ */
+static int die_is_unit_root(die_t *die){
+    return die->die_tag == DW_TAG_compile_unit ||
+        die->die_tag == DW_TAG_partial_unit ||
+        die->die_tag == DW_TAG_skeleton_unit;
+}
+
+/* With SYM_INIT_UNIFY_TYPES, a structure or union can use the members
+ * of an identical type from another compilation unit instead of
+ * keeping its own. Those members' parent is that other type. This
+ * doesn't look at the members, the other compilation unit could have
+ * been freed already.
+ */
+static int shares_children(die_t *die){
+    return die->die_sharedchildren;
+}
+
+/* A DIE while its tree is being built. These are thrown away once the
+ * tree is laid out.
+ */
+struct buildnode {
+    die_t bn_die;
+    Dwarf_Die bn_dwarfdie;
+
+    struct buildnode *bn_parent;
+    struct buildnode *bn_firstchild;
+    struct buildnode *bn_lastchild;
+    struct buildnode *bn_nextsibling;
 
-    /* If this DIE's tag is DW_TAG_subprogram, this will be initialized */
-    void *die_framebaselocdesc;
+    /* Where this DIE ended up after lay_out_die_tree */
+    die_t *bn_laidout;
+
+    /* Identical type whose members this one uses, see unify_types */
+    die_t *bn_canonical;
+
+    /* Set if this type should become canonical once it's laid out */
+    int bn_unifynew;
+    uint64_t bn_unifyhash;
+    uint64_t bn_bytesize;
 };
 
-int die_get_members(die_t *, die_t *, die_t ***, int *, sym_error_t *);
+int die_get_members(die_t *, void *, die_t ***, int *, sym_error_t *);
 int die_pc_to_lineno(Dwarf_Debug, die_t *, uint64_t, uint64_t *, sym_error_t *);
 int die_search(die_t *, void *, int, die_t **, sym_error_t *);
 
@@ -312,25 +453,19 @@ static int get_form_data_from_attr(Dwarf_Debug dbg, Dwarf_Attribute attr,
     return 0;
 }
 
-struct arrdim *create_arrdim(unsigned dim, unsigned sz){
-    struct arrdim *d = malloc(sizeof(struct arrdim));
-    d->dim = dim;
-    d->sz = sz;
-
-    return d;
-}
-
 #define NON_COMPILE_TIME_CONSTANT_SIZE ((Dwarf_Unsigned)-1)
 
-static int lex_block_count = 0, anon_struct_count = 0, anon_union_count = 0,
-           anon_enum_count = 0, IS_POINTER = 0;
+/* Trees for different compilation units can be built on different
+ * threads, so any state kept while building one is per-thread.
+ */
+static _Thread_local int IS_POINTER = 0;
 
 static void generate_data_type_info(Dwarf_Debug dbg, void *compile_unit,
         Dwarf_Die die, char **outtype, Dwarf_Unsigned *outsize,
         Dwarf_Half *base_tag, Dwarf_Die *base_die,
         Dwarf_Half *base_die_encoding, Dwarf_Unsigned *base_data_type_offset,
         Dwarf_Unsigned *arrmembsz, Dwarf_Half *arrmembencoding,
-        unsigned int *classification, struct arrdim ***dims,
+        unsigned int *classification, struct arrdim **dims,
         int *dimslen, int level){
     char *die_name = get_die_name_raw(dbg, die);
     Dwarf_Half die_tag = get_die_tag_raw(dbg, die);
@@ -519,7 +654,7 @@ static void generate_data_type_info(Dwarf_Debug dbg, void *compile_unit,
                 Dwarf_Die unused_base_die = NULL;
                 Dwarf_Unsigned unused_base_data_type_offset = 0;
                 Dwarf_Half membencoding = 0;
-                struct arrdim **dims_unused = NULL;
+                struct arrdim *dims_unused = NULL;
                 int dimslen_unused = 0;
                 generate_data_type_info(dbg, compile_unit, subrange_typedie,
                         &unused_outtype, &membsz, &unused_base_tag,
@@ -529,10 +664,6 @@ static void generate_data_type_info(Dwarf_Debug dbg, void *compile_unit,
                         &dimslen_unused, level+1);
 
                 free(unused_outtype);
-
-                for(int i=0; i<dimslen_unused; i++)
-                    free(dims_unused[i]);
-
                 free(dims_unused);
 
                 *arrmembsz = membsz;
@@ -551,24 +682,22 @@ static void generate_data_type_info(Dwarf_Debug dbg, void *compile_unit,
 
             dwarf_dealloc(dbg, count_attr, DW_DLA_ATTR);
 
-            if(!(*dims))
-                (*dims) = malloc(sizeof(struct arrdim) * ++(*dimslen));
-            else{
-                struct arrdim **arrdims_rea = realloc((*dims),
-                        sizeof(struct arrdim) * ++(*dimslen));
-                (*dims) = arrdims_rea;
-            }
+            struct arrdim *arrdims_rea = realloc((*dims),
+                    sizeof(struct arrdim) * ++(*dimslen));
+            (*dims) = arrdims_rea;
+
+            struct arrdim *newdim = &(*dims)[(*dimslen) - 1];
+            newdim->dim = curdim;
 
             if(ret){
                 /* Variable length array determined at runtime */
-                (*dims)[(*dimslen) - 1] =
-                    create_arrdim(curdim, ARR_DIM_SZ_UNKNOWN);
+                newdim->sz = ARR_DIM_SZ_UNKNOWN;
                 concat(outtype, "[]");
                 *outsize = NON_COMPILE_TIME_CONSTANT_SIZE;
                 break;
             }
 
-            (*dims)[(*dimslen) - 1] = create_arrdim(curdim, nmemb);
+            newdim->sz = nmemb;
 
             concat(outtype, "[%#llx]", nmemb);
 
@@ -659,30 +788,41 @@ static void generate_data_type_info(Dwarf_Debug dbg, void *compile_unit,
     concat(outtype, type_tag_string);
 }
 
-static void get_die_data_type_info(dwarfinfo_t *dwarfinfo, void *compile_unit,
-        die_t **die, int level){
-    Dwarf_Debug dbg = dwarfinfo->di_dbg;
-    Dwarf_Error d_error = NULL;
-    Dwarf_Attribute attr = NULL;
+/* Arena of the compilation unit whose tree is being built on this thread */
+static _Thread_local struct arena *CUR_ARENA = NULL;
 
-    int ret = dwarf_attr((*die)->die_dwarfdie, DW_AT_type, &attr, &d_error);
+/* Name pool of the dwarfinfo whose tree is being built on this thread */
+static _Thread_local void *CUR_STRTAB = NULL;
 
-    if(ret == DW_DLV_ERROR)
-        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+/* Intern a string from libdwarf or the heap and get rid of the original */
+static const char *intern_dwarf_str(Dwarf_Debug dbg, char *str){
+    if(!str)
+        return NULL;
 
-    if(ret != DW_DLV_OK)
-        return;
+    const char *interned = strtab_intern(CUR_STRTAB, str);
+    dwarf_dealloc(dbg, str, DW_DLA_STRING);
 
-    ret = dwarf_global_formref(attr, &((*die)->die_datatypedieoffset),
-            &d_error);
+    return interned;
+}
 
-    if(ret == DW_DLV_ERROR)
-        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+static const char *intern_heap_str(char *str){
+    if(!str)
+        return NULL;
 
-    dwarf_dealloc(dbg, attr, DW_DLA_ATTR);
+    const char *interned = strtab_intern(CUR_STRTAB, str);
+    free(str);
+
+    return interned;
+}
+
+/* Fill in ti for the type DIE at ti->ti_datatypedieoffset */
+static void describe_data_type(Dwarf_Debug dbg, void *compile_unit,
+        void *typecache, struct die_typeinfo *ti){
+    Dwarf_Error d_error = NULL;
+    Dwarf_Die datatypedie = NULL;
 
-    ret = dwarf_offdie(dwarfinfo->di_dbg, (*die)->die_datatypedieoffset,
-            &((*die)->die_datatypedie), &d_error);
+    int ret = dwarf_offdie(dbg, ti->ti_datatypedieoffset, &datatypedie,
+            &d_error);
 
     if(ret == DW_DLV_ERROR)
         dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
@@ -690,10 +830,9 @@ static void get_die_data_type_info(dwarfinfo_t *dwarfinfo, void *compile_unit,
     if(ret != DW_DLV_OK)
         return;
 
-    dwarf_tag((*die)->die_datatypedie,
-            &((*die)->die_datatypedietag), &d_error);
+    dwarf_tag(datatypedie, &ti->ti_datatypedietag, &d_error);
 
-    Dwarf_Half tag = (*die)->die_datatypedietag;
+    Dwarf_Half tag = ti->ti_datatypedietag;
     Dwarf_Half base_tag = 0, base_die_encoding = 0;
     Dwarf_Die base_die = NULL;
 
@@ -703,34 +842,35 @@ static void get_die_data_type_info(dwarfinfo_t *dwarfinfo, void *compile_unit,
      * or an enum, we're done.
      */
     if(tag == DW_TAG_base_type || tag == DW_TAG_enumeration_type){
-        ret = dwarf_diename((*die)->die_datatypedie, &((*die)->die_datatypename),
-                &d_error);
+        char *name = NULL;
+        ret = dwarf_diename(datatypedie, &name, &d_error);
 
         if(ret == DW_DLV_ERROR)
             dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
 
-        ret = dwarf_bytesize((*die)->die_datatypedie, &((*die)->die_databytessize),
-                &d_error);
+        ti->ti_datatypename = intern_dwarf_str(dbg, name);
+
+        ret = dwarf_bytesize(datatypedie, &ti->ti_databytessize, &d_error);
 
         if(ret == DW_DLV_ERROR)
             dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
 
         /* For some reason calling dwarf_formsdata with this attribute
-         * wipes die->die_databytessize...
+         * wipes ti->ti_databytessize...
          */
-        Dwarf_Unsigned sz = (*die)->die_databytessize;
+        Dwarf_Unsigned sz = ti->ti_databytessize;
 
         Dwarf_Attribute dw_at_encoding_attr = NULL;
 
         /* this will fail for DW_TAG_enumeration_type, who cares */
-        get_die_attribute(dbg, (*die)->die_datatypedie, DW_AT_encoding,
+        get_die_attribute(dbg, datatypedie, DW_AT_encoding,
                 &dw_at_encoding_attr);
 
         if(dw_at_encoding_attr){
             get_form_data_from_attr(dbg, dw_at_encoding_attr,
-                    &((*die)->die_datatypeencoding), FORMSDATA);
+                    &ti->ti_datatypeencoding, FORMSDATA);
             dwarf_dealloc(dbg, dw_at_encoding_attr, DW_DLA_ATTR);
-            (*die)->die_databytessize = sz;
+            ti->ti_databytessize = sz;
         }
     }
     else{
@@ -748,11 +888,11 @@ static void get_die_data_type_info(dwarfinfo_t *dwarfinfo, void *compile_unit,
         Dwarf_Unsigned arrmembsz = 0;
         Dwarf_Half arrmembencoding = 0;
 
-        struct arrdim **dims = NULL;
+        struct arrdim *dims = NULL;
         int dimslen = 0;
 
-        generate_data_type_info(dwarfinfo->di_dbg, compile_unit,
-                (*die)->die_datatypedie, &name, &size, &base_tag,
+        generate_data_type_info(dbg, compile_unit,
+                datatypedie, &name, &size, &base_tag,
                 &base_die, &base_die_encoding, &base_data_type_die_offset,
                 &arrmembsz, &arrmembencoding, &classification,
                 &dims, &dimslen, 0);
@@ -762,15 +902,24 @@ static void get_die_data_type_info(dwarfinfo_t *dwarfinfo, void *compile_unit,
 
         IS_POINTER = 0;
 
-        (*die)->die_databytessize = size;
-        (*die)->die_datatypename = name;
-        (*die)->die_datatypeencoding = base_die_encoding;
-        (*die)->die_basedatatypedieoffset = base_data_type_die_offset;
-        (*die)->die_arrmembsz = arrmembsz;
-        (*die)->die_arrdims = dims;
-        (*die)->die_arrdimslen = dimslen;
+        ti->ti_databytessize = size;
+        ti->ti_datatypename = intern_heap_str(name);
+        ti->ti_datatypeencoding = base_die_encoding;
+        ti->ti_basedatatypedieoffset = base_data_type_die_offset;
+        ti->ti_arrmembsz = arrmembsz;
+        ti->ti_arrdimslen = dimslen;
+
+        if(dims){
+            ti->ti_arrdims = typecache_alloc(typecache,
+                    cu_get_offset_key(compile_unit, ti->ti_datatypedieoffset),
+                    sizeof(struct arrdim) * dimslen);
+            memcpy(ti->ti_arrdims, dims, sizeof(struct arrdim) * dimslen);
+            free(dims);
+        }
     }
 
+    dwarf_dealloc(dbg, datatypedie, DW_DLA_DIE);
+
     unsigned int c = classification;
 
     if(!(c & DTC_POINTER) && !(c & DTC_STRUCT) &&
@@ -778,171 +927,299 @@ static void get_die_data_type_info(dwarfinfo_t *dwarfinfo, void *compile_unit,
         classification |= DTC_OTHER;
     }
 
-    (*die)->die_datatypeclass = classification;
+    ti->ti_datatypeclass = classification;
+}
+
+/* Thousands of DIEs can have the same type, so each type is only
+ * described once per dwarfinfo.
+ */
+static void get_die_data_type_info(Dwarf_Debug dbg, void *compile_unit,
+        die_t *die, Dwarf_Die dwarfdie, int level){
+    Dwarf_Error d_error = NULL;
+    Dwarf_Attribute attr = NULL;
+
+    int ret = dwarf_attr(dwarfdie, DW_AT_type, &attr, &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    if(ret != DW_DLV_OK)
+        return;
+
+    Dwarf_Off typeoff = 0;
+
+    ret = dwarf_global_formref(attr, &typeoff, &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    dwarf_dealloc(dbg, attr, DW_DLA_ATTR);
+
+    void *typecache = cu_get_typecache(compile_unit);
+    uint64_t typekey = cu_get_offset_key(compile_unit, typeoff);
+    const struct die_typeinfo *cached = typecache_find(typecache, typekey);
+
+    if(!cached){
+        struct die_typeinfo *ti = typecache_alloc(typecache, typekey,
+                sizeof(struct die_typeinfo));
+
+        ti->ti_datatypedieoffset = typeoff;
+        describe_data_type(dbg, compile_unit, typecache, ti);
+
+        cached = typecache_insert(typecache, typekey, ti);
+    }
+
+    die->die_type = cached;
 }
 
-static die_t *CUR_PARENTS[100] = {0};
+static _Thread_local struct buildnode *CUR_PARENTS[100] = {0};
+
+/* Frame base of the subprogram enclosing the DIE being built at level */
+static void *enclosing_frame_base(int level){
+    if(level == 0)
+        return NULL;
+
+    int pos = level;
+    struct buildnode *curparent = CUR_PARENTS[pos];
+
+    while(pos >= 0 && (!curparent ||
+                curparent->bn_die.die_tag != DW_TAG_subprogram)){
+        curparent = CUR_PARENTS[pos--];
+    }
+
+    if(!curparent || curparent->bn_die.die_tag != DW_TAG_subprogram)
+        return NULL;
+
+    return curparent->bn_die.die_loc->li_framebase;
+}
 
-static void copy_location_lists(Dwarf_Debug dbg, die_t **die,
-        Dwarf_Half whichattr, int level){
+static void copy_location_lists(Dwarf_Debug dbg, die_t *die,
+        Dwarf_Die dwarfdie, struct die_locinfo **li, Dwarf_Half whichattr){
     Dwarf_Attribute attr = NULL;
-    get_die_attribute(dbg, (*die)->die_dwarfdie, whichattr, &attr);
+    get_die_attribute(dbg, dwarfdie, whichattr, &attr);
 
     if(!attr)
         return;
 
     Dwarf_Error d_error = NULL;
     Dwarf_Loc_Head_c loclisthead = NULL;
+    Dwarf_Unsigned lcount = 0;
 
-    int lret = dwarf_get_loclist_c(attr, &loclisthead,
-            &((*die)->die_loclistcnt), &d_error);
+    int lret = dwarf_get_loclist_c(attr, &loclisthead, &lcount, &d_error);
 
     dwarf_dealloc(dbg, attr, DW_DLA_ATTR);
 
-    if(lret == DW_DLV_OK){
-        Dwarf_Unsigned lcount = (*die)->die_loclistcnt;
-
-        initialize_die_loclists(&((*die)->die_loclists), lcount);
-
-        for(Dwarf_Unsigned i=0; i<lcount; i++){
-            Dwarf_Small loclist_source = 0, lle_value = 0;
-            Dwarf_Addr lopc = 0, hipc = 0;
-            Dwarf_Unsigned ulocentry_count = 0, section_offset = 0,
-                           locdesc_offset = 0;
-            Dwarf_Locdesc_c locentry = NULL;
-
-            /* d_error is still NULL */
-
-            lret = dwarf_get_locdesc_entry_c(loclisthead,
-                    i, &lle_value, &lopc, &hipc, &ulocentry_count,
-                    &locentry, &loclist_source, &section_offset,
-                    &locdesc_offset, &d_error);
-            if(lret == DW_DLV_OK){
-                for(Dwarf_Unsigned j=0; j<ulocentry_count; j++){
-                    Dwarf_Small op = 0;
-                    Dwarf_Unsigned opd1 = 0, opd2 = 0, opd3 = 0,
-                                   offsetforbranch = 0;
-
-                    /* d_error is still NULL */
-
-                    int opret = dwarf_get_location_op_value_c(locentry,
-                            j, &op, &opd1, &opd2, &opd3, &offsetforbranch,
-                            &d_error);
-
-                    if(opret == DW_DLV_OK){
-                        uint64_t cudie_lopc = 0, cudie_hipc = 0;
-
-                        /* Low and high PC values here are based off the
-                         * compilation unit's (or root DIE) low PC value when
-                         * loclist_source == LOCATION_LIST_ENTRY. Otherwise,
-                         * lle_value, lopc, and hipc aren't of any use to us.
-                         */
-                        if(loclist_source == LOCATION_LIST_ENTRY){
-                            die_t *cudie = CUR_PARENTS[0];
-
-                            cudie_lopc = cudie->die_low_pc;
-                            cudie_hipc = cudie->die_high_pc;
-                        }
-
-                        uint64_t locdesc_lopc = lopc + cudie_lopc;
-                        uint64_t locdesc_hipc = hipc + cudie_lopc;
-
-                        void *locdesc =
-                            create_location_description(loclist_source,
-                                    locdesc_lopc, locdesc_hipc, op, opd1,
-                                    opd2, opd3, offsetforbranch);
-
-                        if(j > 0){
-                            add_additional_location_description(whichattr,
-                                    (*die)->die_loclists, locdesc, i);
-                        }
-                        else{
-                            if(whichattr == DW_AT_location)
-                                (*die)->die_loclists[i] = locdesc;
-                            else if(whichattr == DW_AT_frame_base)
-                                (*die)->die_framebaselocdesc = locdesc;
-                        }
+    if(lret != DW_DLV_OK){
+        if(lret == DW_DLV_ERROR)
+            dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+        return;
+    }
+
+    if(!(*li))
+        *li = arena_alloc(CUR_ARENA, sizeof(struct die_locinfo));
+
+    void **loclists = NULL;
+
+    if(whichattr == DW_AT_location){
+        (*li)->li_loclistcnt = lcount;
+        initialize_die_loclists(&((*li)->li_loclists), lcount);
+        loclists = (*li)->li_loclists;
+    }
+
+    for(Dwarf_Unsigned i=0; i<lcount; i++){
+        Dwarf_Small loclist_source = 0, lle_value = 0;
+        Dwarf_Addr lopc = 0, hipc = 0;
+        Dwarf_Unsigned ulocentry_count = 0, section_offset = 0,
+                       locdesc_offset = 0;
+        Dwarf_Locdesc_c locentry = NULL;
+
+        /* d_error is still NULL */
+
+        lret = dwarf_get_locdesc_entry_c(loclisthead,
+                i, &lle_value, &lopc, &hipc, &ulocentry_count,
+                &locentry, &loclist_source, &section_offset,
+                &locdesc_offset, &d_error);
+        if(lret == DW_DLV_OK){
+            for(Dwarf_Unsigned j=0; j<ulocentry_count; j++){
+                Dwarf_Small op = 0;
+                Dwarf_Unsigned opd1 = 0, opd2 = 0, opd3 = 0,
+                               offsetforbranch = 0;
+
+                /* d_error is still NULL */
+
+                int opret = dwarf_get_location_op_value_c(locentry,
+                        j, &op, &opd1, &opd2, &opd3, &offsetforbranch,
+                        &d_error);
+
+                if(opret == DW_DLV_OK){
+                    uint64_t cudie_lopc = 0, cudie_hipc = 0;
+
+                    /* Low and high PC values here are based off the
+                     * compilation unit's (or root DIE) low PC value when
+                     * loclist_source == LOCATION_LIST_ENTRY. Otherwise,
+                     * lle_value, lopc, and hipc aren't of any use to us.
+                     */
+                    if(loclist_source == LOCATION_LIST_ENTRY){
+                        die_t *cudie = &CUR_PARENTS[0]->bn_die;
+
+                        cudie_lopc = cudie->die_low_pc;
+                        cudie_hipc = cudie->die_high_pc;
+                    }
+
+                    uint64_t locdesc_lopc = lopc + cudie_lopc;
+                    uint64_t locdesc_hipc = hipc + cudie_lopc;
+
+                    void *locdesc =
+                        create_location_description(loclist_source,
+                                locdesc_lopc, locdesc_hipc, op, opd1,
+                                opd2, opd3, offsetforbranch);
+
+                    if(j > 0){
+                        add_additional_location_description(whichattr,
+                                loclists, locdesc, i);
                     }
                     else{
-                        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+                        if(whichattr == DW_AT_location)
+                            loclists[i] = locdesc;
+                        else if(whichattr == DW_AT_frame_base)
+                            (*li)->li_framebase = locdesc;
                     }
                 }
+                else{
+                    dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+                }
             }
-            else{
-                dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
-            }
+        }
+        else{
+            dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
         }
     }
 
     dwarf_loc_head_c_dealloc(loclisthead);
+}
 
-    /* If this DIE is the child of a subroutine DIE, initialize its
-     * frame base location description.
-     */
-    if((*die)->die_tag != DW_TAG_subprogram && level > 0){
-        int pos = level;
-        die_t *curparent = CUR_PARENTS[pos];
+/* Inlined code that's been split up, like a cold path moved out of
+ * line, has DW_AT_ranges instead of a low and high PC. DWARF 5
+ * .debug_rnglists offsets aren't something dwarf_get_ranges_a reads,
+ * those inlined subroutines just aren't found by PC.
+ */
+static void copy_inline_ranges(Dwarf_Debug dbg, Dwarf_Die dwarfdie,
+        struct die_inlineinfo *ii){
+    Dwarf_Half version = 0, offset_size = 0;
+    dwarf_get_version_of_die(dwarfdie, &version, &offset_size);
 
-        while(pos >= 0 &&
-                (!curparent || curparent->die_tag != DW_TAG_subprogram)){
-            curparent = CUR_PARENTS[pos--];
-        }
+    if(version >= 5)
+        return;
+
+    Dwarf_Attribute attr = NULL;
+    get_die_attribute(dbg, dwarfdie, DW_AT_ranges, &attr);
+
+    if(!attr)
+        return;
+
+    Dwarf_Error d_error = NULL;
+    Dwarf_Off rangesoff = 0;
+    int ret = dwarf_global_formref(attr, &rangesoff, &d_error);
+
+    if(ret == DW_DLV_ERROR){
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+        d_error = NULL;
+
+        /* DWARF 2 and 3 use a constant form for this */
+        ret = dwarf_formudata(attr, &rangesoff, &d_error);
+
+        if(ret == DW_DLV_ERROR)
+            dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+    }
+
+    dwarf_dealloc(dbg, attr, DW_DLA_ATTR);
 
-        if(curparent->die_tag == DW_TAG_subprogram){
-            (*die)->die_framebaselocdesc =
-                copy_locdesc(curparent->die_framebaselocdesc);
+    if(ret != DW_DLV_OK)
+        return;
+
+    Dwarf_Ranges *ranges = NULL;
+    Dwarf_Signed rangescnt = 0;
+    Dwarf_Unsigned bytecnt = 0;
+
+    ret = dwarf_get_ranges_a(dbg, rangesoff, dwarfdie, &ranges, &rangescnt,
+            &bytecnt, &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+    if(ret != DW_DLV_OK)
+        return;
+
+    ii->ii_ranges = arena_alloc(CUR_ARENA,
+            sizeof(struct inlinerange) * (rangescnt ? rangescnt : 1));
+
+    /* Relative to the compilation unit's base address until a base
+     * address selection entry says otherwise.
+     */
+    Dwarf_Unsigned base = CUR_PARENTS[0] ?
+        CUR_PARENTS[0]->bn_die.die_low_pc : 0;
+
+    for(Dwarf_Signed i=0; i<rangescnt; i++){
+        Dwarf_Ranges *r = &ranges[i];
+
+        if(r->dwr_type == DW_RANGES_END)
+            break;
+        else if(r->dwr_type == DW_RANGES_ADDRESS_SELECTION)
+            base = r->dwr_addr2;
+        else if(r->dwr_addr1 < r->dwr_addr2){
+            struct inlinerange *ir = &ii->ii_ranges[ii->ii_numranges++];
+            ir->ir_low = base + r->dwr_addr1;
+            ir->ir_high = base + r->dwr_addr2;
         }
     }
+
+    dwarf_ranges_dealloc(dbg, ranges, rangescnt);
 }
 
-static int copy_die_info(dwarfinfo_t *dwarfinfo, void *compile_unit,
-        die_t **die, int level){
-    Dwarf_Debug dbg = dwarfinfo->di_dbg;
+static int copy_die_info(Dwarf_Debug dbg, void *compile_unit,
+        die_t *die, Dwarf_Die dwarfdie, int level){
     Dwarf_Error d_error = NULL;
 
-    int ret = dwarf_diename((*die)->die_dwarfdie, &((*die)->die_diename),
-            &d_error);
+    die->die_type = &NO_TYPEINFO;
+    die->die_loc = &NO_LOCINFO;
+
+    char *name = NULL;
+    int ret = dwarf_diename(dwarfdie, &name, &d_error);
 
     if(ret == DW_DLV_ERROR)
         dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
 
-    ret = dwarf_dieoffset((*die)->die_dwarfdie, &((*die)->die_dieoffset),
-            &d_error);
+    die->die_diename = intern_dwarf_str(dbg, name);
+
+    ret = dwarf_dieoffset(dwarfdie, &die->die_dieoffset, &d_error);
 
     if(ret == DW_DLV_ERROR)
         dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
 
-    dwarf_tag((*die)->die_dwarfdie, &((*die)->die_tag), &d_error);
+    dwarf_tag(dwarfdie, &die->die_tag, &d_error);
 
     if(ret == DW_DLV_ERROR)
         dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
 
-    if(is_anonymous_type(*die)){
-        (*die)->die_anon = 1;
-
-        const char *type = "STRUCT";
-        int *cnter = &anon_struct_count;
-
-        if((*die)->die_tag == DW_TAG_union_type){
-            type = "UNION";
-            cnter = &anon_union_count;
-        }
-        else if((*die)->die_tag == DW_TAG_enumeration_type){
-            type = "ENUM";
-            cnter = &anon_enum_count;
-        }
+    /* Anonymous types and lexical blocks are named later, by
+     * die_tree_name_generated_dies, once we know where this compilation
+     * unit falls in the numbering.
+     */
+    if(is_anonymous_type(die))
+        die->die_anon = 1;
+    else if(is_inlined_subroutine(die)){
+        die->die_inlinedsub = 1;
 
-        concat(&((*die)->die_diename), "ANON_%s_%d", type, (*cnter)++);
-    }
-    else if(is_inlined_subroutine(*die)){
-        (*die)->die_inlinedsub = 1;
+        struct die_inlineinfo *ii =
+            arena_alloc(CUR_ARENA, sizeof(struct die_inlineinfo));
 
         Dwarf_Attribute typeattr = NULL;
-        int ret = dwarf_attr((*die)->die_dwarfdie, DW_AT_abstract_origin,
+        int ret = dwarf_attr(dwarfdie, DW_AT_abstract_origin,
                 &typeattr, &d_error);
 
         if(ret == DW_DLV_OK){
-            ret = dwarf_global_formref(typeattr, &((*die)->die_aboriginoff),
+            ret = dwarf_global_formref(typeattr, &ii->ii_aboriginoff,
                     &d_error);
 
             if(ret == DW_DLV_ERROR)
@@ -950,52 +1227,78 @@ static int copy_die_info(dwarfinfo_t *dwarfinfo, void *compile_unit,
 
             dwarf_dealloc(dbg, typeattr, DW_DLA_ATTR);
         }
-    }
 
-    dwarf_get_TAG_name((*die)->die_tag, (const char **)&((*die)->die_tagname));
+        Dwarf_Attribute callattr = NULL;
+        get_die_attribute(dbg, dwarfdie, DW_AT_call_file, &callattr);
+
+        if(callattr){
+            get_form_data_from_attr(dbg, callattr, &ii->ii_callfile,
+                    FORMUDATA);
+            dwarf_dealloc(dbg, callattr, DW_DLA_ATTR);
+            callattr = NULL;
+        }
+
+        get_die_attribute(dbg, dwarfdie, DW_AT_call_line, &callattr);
 
-    /* Label these ourselves */
-    if(!(*die)->die_diename){
-        if((*die)->die_tag == DW_TAG_lexical_block){
-            concat(&((*die)->die_diename), "LEXICAL_BLOCK_%d",
-                    lex_block_count++);
-            (*die)->die_lexblock = 1;
+        if(callattr){
+            get_form_data_from_attr(dbg, callattr, &ii->ii_callline,
+                    FORMUDATA);
+            dwarf_dealloc(dbg, callattr, DW_DLA_ATTR);
         }
+
+        copy_inline_ranges(dbg, dwarfdie, ii);
+
+        die->die_inline = ii;
     }
 
-    dwarf_die_abbrev_children_flag((*die)->die_dwarfdie,
-            &((*die)->die_haschildren));
+    if(!die->die_diename && die->die_tag == DW_TAG_lexical_block)
+        die->die_lexblock = 1;
 
-    get_die_data_type_info(dwarfinfo, compile_unit, die, level);
+    Dwarf_Half haschildren = 0;
+    dwarf_die_abbrev_children_flag(dwarfdie, &haschildren);
+    die->die_haschildren = haschildren != 0;
 
-    ret = dwarf_lowpc((*die)->die_dwarfdie, &((*die)->die_low_pc), &d_error);
+    get_die_data_type_info(dbg, compile_unit, die, dwarfdie, level);
+
+    ret = dwarf_lowpc(dwarfdie, &die->die_low_pc, &d_error);
 
     if(ret == DW_DLV_ERROR)
         dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
 
     Dwarf_Half retform = 0;
     enum Dwarf_Form_Class retformclass = 0;
-    ret = dwarf_highpc_b((*die)->die_dwarfdie, &((*die)->die_high_pc), &retform,
+    ret = dwarf_highpc_b(dwarfdie, &die->die_high_pc, &retform,
             &retformclass, &d_error);
 
     if(ret == DW_DLV_ERROR)
         dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
 
-    (*die)->die_high_pc += (*die)->die_low_pc;
+    /* Only an offset from low PC when it isn't an address */
+    if(ret == DW_DLV_OK && retformclass == DW_FORM_CLASS_CONSTANT)
+        die->die_high_pc += die->die_low_pc;
 
     Dwarf_Attribute memb_attr = NULL;
-    get_die_attribute(dbg, (*die)->die_dwarfdie, DW_AT_data_member_location,
+    get_die_attribute(dbg, dwarfdie, DW_AT_data_member_location,
             &memb_attr);
 
     // XXX check for location list once expression evaluator is done
     // will have to encounter this
     if(memb_attr)
-        get_form_data_from_attr(dbg, memb_attr, &((*die)->die_memb_off), FORMUDATA);
+        get_form_data_from_attr(dbg, memb_attr, &die->die_memb_off, FORMUDATA);
 
     dwarf_dealloc(dbg, memb_attr, DW_DLA_ATTR);
 
-    copy_location_lists(dbg, die, DW_AT_location, level);
-    copy_location_lists(dbg, die, DW_AT_frame_base, level);
+    struct die_locinfo *li = NULL;
+
+    copy_location_lists(dbg, die, dwarfdie, &li, DW_AT_location);
+    copy_location_lists(dbg, die, dwarfdie, &li, DW_AT_frame_base);
+
+    /* Everything beneath a subprogram shares its frame base */
+    if(li && die->die_tag != DW_TAG_subprogram)
+        li->li_framebase = enclosing_frame_base(level);
+
+    if(li)
+        die->die_loc = li;
 
     return 0;
 }
@@ -1017,13 +1320,13 @@ static int does_die_represent_what(die_t *die, int *retval, int what,
     }
 
     if(what == PTR)
-        *retval = die->die_datatypeclass & DTC_POINTER;
+        *retval = die->die_type->ti_datatypeclass & DTC_POINTER;
     else if(what == STRUCT)
-        *retval = die->die_datatypeclass & DTC_STRUCT;
+        *retval = die->die_type->ti_datatypeclass & DTC_STRUCT;
     else if(what == UNION)
-        *retval = die->die_datatypeclass & DTC_UNION;
+        *retval = die->die_type->ti_datatypeclass & DTC_UNION;
     else if(what == ARRAY)
-        *retval = die->die_datatypeclass & DTC_ARRAY;
+        *retval = die->die_type->ti_datatypeclass & DTC_ARRAY;
 
     return 0;
 }
@@ -1061,20 +1364,20 @@ static void describe_die_internal(die_t *die, int level){
         varnamecolorstr = GREEN;
 
     printf("%#llx: <%d> <%s>: '%s%s%s', is parent: %d",
-            die->die_dieoffset, level, die->die_tagname,
+            die->die_dieoffset, level, get_tag_name(die->die_tag),
             varnamecolorstr, die->die_diename, RESET,
             die->die_haschildren);
 
     printf(", type DIE at %s%#llx%s",
-            die->die_datatypedieoffset!=0?CYAN:"",
-            die->die_datatypedieoffset, die->die_datatypedieoffset!=0?RESET:"");
+            die->die_type->ti_datatypedieoffset!=0?CYAN:"",
+            die->die_type->ti_datatypedieoffset, die->die_type->ti_datatypedieoffset!=0?RESET:"");
 
-    if(die->die_datatypedieoffset!=0){
-        printf(", type = '"LIGHT_BLUE"%s"RESET"'", die->die_datatypename);
+    if(die->die_type->ti_datatypedieoffset!=0){
+        printf(", type = '"LIGHT_BLUE"%s"RESET"'", die->die_type->ti_datatypename);
 
         if(die->die_tag != DW_TAG_subprogram){
             printf(", sizeof(%s%s%s) = "LIGHT_YELLOW"%#llx"RESET"",
-                    varnamecolorstr, die->die_diename, RESET, die->die_databytessize);
+                    varnamecolorstr, die->die_diename, RESET, die->die_type->ti_databytessize);
         }
     }
 
@@ -1082,11 +1385,11 @@ static void describe_die_internal(die_t *die, int level){
             die->die_tag == DW_TAG_variable ||
             die->die_tag == DW_TAG_member){
         const char *e = NULL;
-        dwarf_get_ATE_name(die->die_datatypeencoding, &e);
+        dwarf_get_ATE_name(die->die_type->ti_datatypeencoding, &e);
 
         if(e)
             printf(", data type encoding = "WHITE_BG""BLACK"%s"RESET""RESET_BG, e);
-        int c = die->die_datatypeclass;
+        int c = die->die_type->ti_datatypeclass;
         int ptr = c & DTC_POINTER;
         int s = c & DTC_STRUCT;
         int u = c & DTC_UNION;
@@ -1100,13 +1403,13 @@ static void describe_die_internal(die_t *die, int level){
                 none?GREEN_BG:RED_BG, none?BLACK:"", RESET, RESET_BG);
     }
    
-    if(die->die_datatypedietag == DW_TAG_array_type){
+    if(die->die_type->ti_datatypedietag == DW_TAG_array_type){
         printf(", membsz = %s%s%#llx%s%s",
-                MAGENTA_BG, LIGHT_YELLOW, die->die_arrmembsz,
+                MAGENTA_BG, LIGHT_YELLOW, die->die_type->ti_arrmembsz,
                 RESET, RESET_BG);
     }
 
-    if(die->die_tag == DW_TAG_compile_unit ||
+    if(die_is_unit_root(die) ||
             die->die_tag == DW_TAG_subprogram ||
             die->die_tag == DW_TAG_lexical_block){
         printf(", low PC = "YELLOW"%#llx"RESET", high PC = "YELLOW"%#llx"RESET"",
@@ -1114,22 +1417,24 @@ static void describe_die_internal(die_t *die, int level){
     }
 
     if(die->die_tag == DW_TAG_member){
-        char *parentname = die->die_parent->die_diename;
+        const char *parentname = die->die_parent->die_diename;
         printf(", offset = "GREEN"%s"RESET"+"LIGHT_GREEN"%#llx"RESET"",
                 parentname, die->die_memb_off);
     }
 
     if(level == 0){
-        printf(", srclinescnt = "MAGENTA"%lld"RESET"", die->die_srclinescnt);
+        printf(", srclinescnt = "MAGENTA"%d"RESET"",
+                linetable_get_num_rows(get_unitinfo(die) ?
+                    get_unitinfo(die)->ui_linetable : NULL));
     }
 
-    if(die->die_loclistcnt > 0){ 
+    if(die->die_loc->li_loclistcnt > 0){ 
         printf(", loclistcnt = %s%#llx%s",
-                BLUE_BG, die->die_loclistcnt, RESET_BG);
+                BLUE_BG, die->die_loc->li_loclistcnt, RESET_BG);
     }
 
     if(die->die_inlinedsub)
-        printf(", abstract origin %s%#llx%s", MAGENTA, die->die_aboriginoff, RESET);
+        printf(", abstract origin %s%#llx%s", MAGENTA, die->die_inline->ii_aboriginoff, RESET);
 
     if(!die->die_haschildren && die->die_parent){
         printf(", parent DIE name '"GREEN"%s"RESET"'\n", die->die_parent->die_diename);
@@ -1150,11 +1455,11 @@ static void describe_die_internal(die_t *die, int level){
     // XXX for testing read_buffer location lists
     uint64_t pc = 0x1000191d4;
 
-    if(die->die_loclistcnt > 0){
+    if(die->die_loc->li_loclistcnt > 0){
         putseparator = 1;
 
-        for(Dwarf_Unsigned i=0; i<die->die_loclistcnt; i++){
-            void *current = die->die_loclists[i];
+        for(Dwarf_Unsigned i=0; i<die->die_loc->li_loclistcnt; i++){
+            void *current = die->die_loc->li_loclists[i];
 
             int idx2 = 0;
             while(current){
@@ -1169,7 +1474,7 @@ static void describe_die_internal(die_t *die, int level){
                 current = get_next_location_description(current);
             }
 
-            current = die->die_loclists[i];
+            current = die->die_loc->li_loclists[i];
 
             if(current){
                 write_tabs(level);
@@ -1189,7 +1494,7 @@ static void describe_die_internal(die_t *die, int level){
                 uint64_t result = 0;
 
                 char *loc_desc_decoded =
-                    decode_location_description(die->die_framebaselocdesc,
+                    decode_location_description(die->die_loc->li_framebase,
                             current, pc, &result);
                 printf(" Decoded: '%s'\n", loc_desc_decoded);
                 free(loc_desc_decoded);
@@ -1197,9 +1502,9 @@ static void describe_die_internal(die_t *die, int level){
         }
     }
 
-    if(die->die_framebaselocdesc){
+    if(die->die_loc->li_framebase){
         int byteswritten = 0;
-        describe_location_description(die->die_framebaselocdesc, 1, 0, 0, level, &byteswritten);
+        describe_location_description(die->die_loc->li_framebase, 1, 0, 0, level, &byteswritten);
         if(byteswritten > maxbyteswritten)
             maxbyteswritten = byteswritten;
 
@@ -1221,8 +1526,8 @@ static void describe_die_internal(die_t *die, int level){
 
         uint64_t result = 0;
         char *loc_desc_decoded =
-            decode_location_description(die->die_framebaselocdesc,
-                    die->die_framebaselocdesc, pc, &result);
+            decode_location_description(die->die_loc->li_framebase,
+                    die->die_loc->li_framebase, pc, &result);
         printf(" Decoded: '%s'\n", loc_desc_decoded);
         free(loc_desc_decoded);
 
@@ -1244,27 +1549,7 @@ static void describe_die_internal(die_t *die, int level){
     }
 }
 
-static die_t *create_new_die(dwarfinfo_t *dwarfinfo, void *compile_unit,
-        Dwarf_Die based_on, int level){
-    if(!based_on)
-        return NULL;
-
-    die_t *d = calloc(1, sizeof(die_t));
-    d->die_dwarfdie = based_on;
-
-    copy_die_info(dwarfinfo, compile_unit, &d, level);
-
-    if(d->die_haschildren){
-        d->die_children = malloc(sizeof(die_t));
-        d->die_children[0] = NULL;
-
-        d->die_numchildren = 0;
-    }
-
-    return d;
-}
-
-static int should_add_die_to_tree(die_t *die){
+static int should_add_die_to_tree(Dwarf_Half tag){
     const static Dwarf_Half accepted_tags[] = {
         DW_TAG_compile_unit, DW_TAG_subprogram, DW_TAG_inlined_subroutine,
         DW_TAG_formal_parameter, DW_TAG_enumeration_type, DW_TAG_enumerator,
@@ -1275,113 +1560,322 @@ static int should_add_die_to_tree(die_t *die){
     size_t count = sizeof(accepted_tags) / sizeof(Dwarf_Half);
 
     for(size_t i=0; i<count; i++){
-        if(die->die_tag == accepted_tags[i])
+        if(tag == accepted_tags[i])
             return 1;
     }
 
     return 0;
 }
 
-static void add_die_to_tree(die_t *current, int level){
-    if(level == 0){
-        CUR_PARENTS[level] = current;
-        return;
-    }
+/* Build nodes for the tree being built on this thread come from here */
+static _Thread_local struct arena *CUR_SCRATCH = NULL;
+static _Thread_local uint32_t CUR_NUMNODES = 0;
 
-    die_t *parent = NULL;
+static struct buildnode *new_buildnode(Dwarf_Debug dbg, void *compile_unit,
+        Dwarf_Die based_on, int level){
+    struct buildnode *bn = arena_alloc(CUR_SCRATCH, sizeof(struct buildnode));
+    bn->bn_dwarfdie = based_on;
 
-    if(current->die_haschildren){
-        CUR_PARENTS[level] = current;
-        parent = CUR_PARENTS[level - 1];
-    }
-    else{
-        int sub = 1;
-        parent = CUR_PARENTS[level - sub];
+    copy_die_info(dbg, compile_unit, &bn->bn_die, based_on, level);
 
-        /* Find the closest valid parent. We could be multiple levels
-         * deep without seeing `level` amount of parent DIEs.
-         */
-        while(!parent)
+    CUR_NUMNODES++;
+
+    return bn;
+}
+
+/* Returns NULL for DIEs that don't belong in the tree, there's no
+ * reason to copy anything out of them.
+ */
+static struct buildnode *create_new_die(Dwarf_Debug dbg, void *compile_unit,
+        Dwarf_Die based_on, int level){
+    if(!based_on)
+        return NULL;
+
+    if(!should_add_die_to_tree(get_die_tag_raw(dbg, based_on)))
+        return NULL;
+
+    return new_buildnode(dbg, compile_unit, based_on, level);
+}
+
+static void add_die_to_tree(struct buildnode *current, int level){
+    if(level == 0){
+        CUR_PARENTS[level] = current;
+        return;
+    }
+
+    struct buildnode *parent = NULL;
+
+    if(current->bn_die.die_haschildren){
+        CUR_PARENTS[level] = current;
+        parent = CUR_PARENTS[level - 1];
+    }
+    else{
+        int sub = 1;
+        parent = CUR_PARENTS[level - sub];
+
+        /* Find the closest valid parent. We could be multiple levels
+         * deep without seeing `level` amount of parent DIEs.
+         */
+        while(!parent)
             parent = CUR_PARENTS[level - (++sub)];
     }
 
     if(parent){
-        die_t **children = realloc(parent->die_children,
-                (++parent->die_numchildren) * sizeof(die_t));
-        parent->die_children = children;
-        parent->die_children[parent->die_numchildren - 1] = current;
-        parent->die_children[parent->die_numchildren] = NULL;
+        if(parent->bn_lastchild)
+            parent->bn_lastchild->bn_nextsibling = current;
+        else
+            parent->bn_firstchild = current;
+
+        parent->bn_lastchild = current;
+
+        current->bn_parent = parent;
+    }
+}
+
+/* Copy the finished tree into one array, breadth first, so every
+ * DIE's children are contiguous. The libdwarf DIEs aren't needed
+ * after this.
+ */
+static die_t *lay_out_die_tree(Dwarf_Debug dbg, struct buildnode *root){
+    die_t *nodes = arena_alloc(CUR_ARENA, sizeof(die_t) * CUR_NUMNODES);
+    struct buildnode **queue = malloc(sizeof(struct buildnode *) *
+            CUR_NUMNODES);
+
+    queue[0] = root;
+    nodes[0] = root->bn_die;
+
+    uint32_t next = 1;
+
+    for(uint32_t q=0; q<next; q++){
+        struct buildnode *bn = queue[q];
+        die_t *die = &nodes[q];
+
+        bn->bn_laidout = die;
+
+        die->die_children = &nodes[next];
+        die->die_numchildren = 0;
+
+        for(struct buildnode *child = bn->bn_firstchild; child;
+                child = child->bn_nextsibling){
+            queue[next] = child;
+            nodes[next] = child->bn_die;
+            nodes[next].die_parent = die;
+
+            die->die_numchildren++;
+            next++;
+        }
+
+        if(bn->bn_canonical){
+            die->die_children = bn->bn_canonical->die_children;
+            die->die_numchildren = bn->bn_canonical->die_numchildren;
+            die->die_sharedchildren = 1;
+        }
+        else if(die->die_numchildren == 0){
+            die->die_children = NULL;
+        }
 
-        current->die_parent = parent;
+        dwarf_dealloc(dbg, bn->bn_dwarfdie, DW_DLA_DIE);
     }
+
+    free(queue);
+
+    return nodes;
 }
 
-static void die_free(Dwarf_Debug dbg, die_t *die, int critical){
+/* Free whatever this DIE owns outside of its tree's arena */
+static void die_free(die_t *die){
     if(!die)
         return;
 
-    if(critical){
-        if(die->die_dwarfdie){
-            dwarf_dealloc(dbg, die->die_dwarfdie, DW_DLA_DIE);
-            die->die_dwarfdie = NULL;
+    struct die_unitinfo *ui = get_unitinfo(die);
+
+    if(ui){
+        linetable_free(ui->ui_linetable);
+
+        if(ui->ui_fxnindex){
+            free(ui->ui_fxnindex->fi_ranges);
+            free(ui->ui_fxnindex);
+        }
+
+        if(ui->ui_inlineindex){
+            free(ui->ui_inlineindex->fi_ranges);
+            free(ui->ui_inlineindex);
         }
     }
-    else{
-        free(die->die_children);
-        die->die_children = NULL;
+
+    const struct die_locinfo *li = die->die_loc;
+
+    for(Dwarf_Unsigned i=0; i<li->li_loclistcnt; i++)
+        loc_free(li->li_loclists[i]);
+
+    free(li->li_loclists);
+
+    /* Anything else with a frame base is sharing its subprogram's */
+    if(die->die_tag == DW_TAG_subprogram && li->li_framebase)
+        loc_free(li->li_framebase);
+}
+
+static uint64_t layout_hash_add(uint64_t hash, uint64_t value){
+    hash ^= value;
+    hash *= 0x100000001b3ULL;
+
+    return hash;
+}
+
+/* Names are interned, so their pointers can stand in for them */
+static uint64_t member_layout_hash(uint64_t hash, const die_t *member){
+    hash = layout_hash_add(hash, (uintptr_t)member->die_diename);
+    hash = layout_hash_add(hash, member->die_memb_off);
+    hash = layout_hash_add(hash, (uintptr_t)member->die_type->ti_datatypename);
+    hash = layout_hash_add(hash, member->die_type->ti_databytessize);
+
+    return hash;
+}
+
+/* Type DIE offsets differ between compilation units, so member types
+ * are compared by what they describe.
+ */
+static int same_member_layout(const die_t *a, const die_t *b){
+    const struct die_typeinfo *ta = a->die_type, *tb = b->die_type;
+
+    return a->die_diename == b->die_diename &&
+        a->die_memb_off == b->die_memb_off &&
+        ta->ti_datatypename == tb->ti_datatypename &&
+        ta->ti_databytessize == tb->ti_databytessize &&
+        ta->ti_datatypeclass == tb->ti_datatypeclass &&
+        ta->ti_datatypeencoding == tb->ti_datatypeencoding;
+}
+
+/* Passed to typeunify_find, canonical is a laid out die_t and
+ * arg is the struct buildnode we want to get rid of the members of.
+ */
+static int same_layout(void *canonical, void *arg){
+    die_t *die = canonical;
+    struct buildnode *bn = arg;
+
+    if(die->die_tag != bn->bn_die.die_tag ||
+            die->die_diename != bn->bn_die.die_diename){
+        return 0;
     }
 
-    if(die->die_srclines){
-        dwarf_srclines_dealloc(dbg, die->die_srclines, die->die_srclinescnt);
-        die->die_srclines = NULL;
+    struct buildnode *child = bn->bn_firstchild;
+
+    for(uint32_t idx=0; idx<die->die_numchildren; idx++){
+        if(!child || !same_member_layout(&die->die_children[idx],
+                    &child->bn_die)){
+            return 0;
+        }
+
+        child = child->bn_nextsibling;
     }
 
-    if(!die->die_anon && !die->die_lexblock){
-        if(die->die_diename)
-            dwarf_dealloc(dbg, die->die_diename, DW_DLA_STRING);
+    return child == NULL;
+}
+
+/* Named structures and unions whose children are all plain members.
+ * Anonymous types are left alone, they aren't named until the tree
+ * is finished.
+ */
+static int is_unification_candidate(struct buildnode *bn){
+    die_t *die = &bn->bn_die;
+
+    if(die->die_tag != DW_TAG_structure_type &&
+            die->die_tag != DW_TAG_union_type){
+        return 0;
     }
-    else{
-        free(die->die_diename);
+
+    if(die->die_anon || !die->die_diename || !bn->bn_firstchild)
+        return 0;
+
+    for(struct buildnode *child = bn->bn_firstchild; child;
+            child = child->bn_nextsibling){
+        if(child->bn_die.die_tag != DW_TAG_member || child->bn_firstchild)
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Before the tree is laid out, drop the members of every type that's
+ * identical to one a compilation unit we've already built has, and
+ * remember which type to use the members of instead.
+ */
+static void unify_types(Dwarf_Debug dbg, void *typeunify,
+        struct buildnode *bn){
+    if(!is_unification_candidate(bn)){
+        for(struct buildnode *child = bn->bn_firstchild; child;
+                child = child->bn_nextsibling){
+            unify_types(dbg, typeunify, child);
+        }
+
+        return;
     }
 
-    die->die_diename = NULL;
+    Dwarf_Error d_error = NULL;
+    Dwarf_Unsigned size = 0;
+
+    int ret = dwarf_bytesize(bn->bn_dwarfdie, &size, &d_error);
+
+    if(ret == DW_DLV_ERROR)
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
 
-    if(die->die_datatypedie){
-        dwarf_dealloc(dbg, die->die_datatypedie, DW_DLA_DIE);
-        die->die_datatypedie = NULL;
+    uint64_t hash = layout_hash_add(0xcbf29ce484222325ULL, bn->bn_die.die_tag);
+    hash = layout_hash_add(hash, (uintptr_t)bn->bn_die.die_diename);
+    hash = layout_hash_add(hash, size);
+
+    for(struct buildnode *child = bn->bn_firstchild; child;
+            child = child->bn_nextsibling){
+        hash = member_layout_hash(hash, &child->bn_die);
     }
 
-    /* see get_die_data_type_info */
-    if(die->die_datatypedietag == DW_TAG_base_type ||
-            die->die_datatypedietag == DW_TAG_enumeration_type){
-        dwarf_dealloc(dbg, die->die_datatypename, DW_DLA_STRING);
+    die_t *canonical = typeunify_find(typeunify, hash, size, same_layout, bn);
+
+    if(!canonical){
+        bn->bn_unifynew = 1;
+        bn->bn_unifyhash = hash;
+        bn->bn_bytesize = size;
+
+        return;
     }
-    else{
-        free(die->die_datatypename);
+
+    uint32_t dropped = 0;
+    struct buildnode *child = bn->bn_firstchild;
+
+    while(child){
+        struct buildnode *next = child->bn_nextsibling;
+
+        die_free(&child->bn_die);
+        dwarf_dealloc(dbg, child->bn_dwarfdie, DW_DLA_DIE);
+        dropped++;
+
+        child = next;
     }
 
-    for(int i=0; i<die->die_arrdimslen; i++)
-        free(die->die_arrdims[i]);
-    free(die->die_arrdims);
+    bn->bn_firstchild = NULL;
+    bn->bn_lastchild = NULL;
+    bn->bn_canonical = canonical;
 
-    die->die_arrdims = NULL;
+    CUR_NUMNODES -= dropped;
 
-    for(Dwarf_Unsigned i=0; i<die->die_loclistcnt; i++)
-        loc_free(die->die_loclists[i]);
+    typeunify_add_savings(typeunify, sizeof(die_t) * dropped);
+}
 
-    if(die->die_loclists){
-        free(die->die_loclists);
-        die->die_loclists = NULL;
-        die->die_loclistcnt = 0;
+/* Make the types unify_types didn't find a match for canonical */
+static void add_unified_types(void *typeunify, struct buildnode *bn){
+    if(bn->bn_unifynew){
+        typeunify_add(typeunify, bn->bn_unifyhash, bn->bn_bytesize,
+                bn->bn_laidout);
+        return;
     }
 
-    if(die->die_framebaselocdesc){
-        loc_free(die->die_framebaselocdesc);
-        die->die_framebaselocdesc = NULL;
+    for(struct buildnode *child = bn->bn_firstchild; child;
+            child = child->bn_nextsibling){
+        add_unified_types(typeunify, child);
     }
 }
 
-/* This tree only contains DIEs with these tags:
+/* This tree only contains DIEs with these tags, plus the root, whatever
+ * kind of unit it is:
  *      DW_TAG_compile_unit
  *      DW_TAG_subprogram
  *      DW_TAG_inlined_subroutine
@@ -1397,42 +1891,41 @@ static void die_free(Dwarf_Debug dbg, die_t *die, int critical){
  * aspect of a DIE, and we're able to retrieve the info we need if
  * we already have a target DIE.
  */
-static void construct_die_tree(dwarfinfo_t *dwarfinfo, void *compile_unit,
-        die_t *current, int level){
+static void construct_die_tree(Dwarf_Debug dbg, void *compile_unit,
+        Dwarf_Die cur_die, struct buildnode *current, int level){
     int is_info = 1;
-    Dwarf_Die child_die = NULL, cur_die = current->die_dwarfdie;
-    Dwarf_Die cur_die_backup = NULL;
+    Dwarf_Die child_die = NULL;
     Dwarf_Error d_error = NULL;
 
     int ret = DW_DLV_OK;
 
-    /* We don't want to deallocate the DWARF DIE associated with the
-     * parameter because it is used in dwarf_siblingof_b.
-     */
-    int critical = 0;
-
-    if(should_add_die_to_tree(current))
+    if(current)
         add_die_to_tree(current, level);
-    else{
-        die_free(dwarfinfo->di_dbg, current, critical);
-        free(current);
-        current = NULL;
-    }
+
+    /* cur_die's node, NULL if it was left out of the tree */
+    struct buildnode *node = current;
 
     for(;;){
         ret = dwarf_child(cur_die, &child_die, NULL);
 
         if(ret == DW_DLV_OK){
-            die_t *cd = create_new_die(dwarfinfo, compile_unit, child_die, level);
-            construct_die_tree(dwarfinfo, compile_unit, cd, level+1);
+            struct buildnode *cd = create_new_die(dbg, compile_unit,
+                    child_die, level);
+            construct_die_tree(dbg, compile_unit, child_die, cd, level+1);
         }
 
         Dwarf_Die sibling_die = NULL;
-        ret = dwarf_siblingof_b(dwarfinfo->di_dbg, cur_die, is_info,
+        ret = dwarf_siblingof_b(dbg, cur_die, is_info,
                 &sibling_die, &d_error);
 
+        /* lay_out_die_tree only releases DIEs that made it into the
+         * tree. Nothing needs this one after its child and sibling.
+         */
+        if(!node)
+            dwarf_dealloc(dbg, cur_die, DW_DLA_DIE);
+
         if(ret == DW_DLV_ERROR)
-            dwarf_dealloc(dwarfinfo->di_dbg, d_error, DW_DLA_ERROR);
+            dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
         else if(ret == DW_DLV_NO_ENTRY){
             /* Discard the parent we were on */
             CUR_PARENTS[level] = NULL;
@@ -1440,16 +1933,10 @@ static void construct_die_tree(dwarfinfo_t *dwarfinfo, void *compile_unit,
         }
 
         cur_die = sibling_die;
+        node = create_new_die(dbg, compile_unit, cur_die, level);
 
-        die_t *newdie = create_new_die(dwarfinfo, compile_unit, cur_die, level);
-
-        if(should_add_die_to_tree(newdie))
-            add_die_to_tree(newdie, level);
-        else{
-            die_free(dwarfinfo->di_dbg, newdie, critical);
-            free(newdie);
-            newdie = NULL;
-        }
+        if(node)
+            add_die_to_tree(node, level);
     }
 }
 
@@ -1463,20 +1950,95 @@ static void display_die_tree_internal(die_t *die, int level){
     if(!die->die_haschildren)
         return;
     else{
-        int idx = 0;
-        die_t *child = die->die_children[idx];
+        for(uint32_t idx=0; idx<die->die_numchildren; idx++){
+            die_t *child = &die->die_children[idx];
 
-        while(child){
             display_die_tree_internal(child, level+1);
-            child = die->die_children[++idx];
         }
     }
 }
 
+/* Label anonymous types and lexical blocks ourselves. Names are numbered
+ * in tree order, continuing from where the previous compilation unit
+ * left off, so they come out the same no matter which thread built
+ * the tree.
+ */
+void die_tree_name_generated_dies(dwarfinfo_t *dwarfinfo, die_t *die){
+    if(!die)
+        return;
+
+    char name[64];
+
+    if(die->die_anon){
+        const char *type = "STRUCT";
+        int *cnter = &dwarfinfo->di_anonstructcnt;
+
+        if(die->die_tag == DW_TAG_union_type){
+            type = "UNION";
+            cnter = &dwarfinfo->di_anonunioncnt;
+        }
+        else if(die->die_tag == DW_TAG_enumeration_type){
+            type = "ENUM";
+            cnter = &dwarfinfo->di_anonenumcnt;
+        }
+
+        snprintf(name, sizeof(name), "ANON_%s_%d", type, (*cnter)++);
+        die->die_diename = strtab_intern(dwarfinfo->di_strtab, name);
+    }
+    else if(die->die_lexblock){
+        snprintf(name, sizeof(name), "LEXICAL_BLOCK_%d",
+                dwarfinfo->di_lexblockcnt++);
+        die->die_diename = strtab_intern(dwarfinfo->di_strtab, name);
+    }
+
+    /* The type we share members with names them */
+    if(!die->die_haschildren || shares_children(die))
+        return;
+
+    for(uint32_t idx=0; idx<die->die_numchildren; idx++){
+        die_t *child = &die->die_children[idx];
+
+        die_tree_name_generated_dies(dwarfinfo, child);
+    }
+}
+
+/* Add this tree's DIEs to the global name and offset indexes. Must run
+ * after die_tree_name_generated_dies so generated names are indexed too.
+ */
+void die_tree_index(dwarfinfo_t *dwarfinfo, void *cu, die_t *die){
+    if(!die)
+        return;
+
+    hashmap_set(dwarfinfo->di_dieoffsets,
+            cu_get_offset_key(cu, die->die_dieoffset), die);
+
+    if(die->die_diename){
+        nameindex_add(dwarfinfo->di_nameindex, die->die_diename, die, cu,
+                die->die_tag);
+    }
+
+    /* Shared members are indexed under the type that owns them */
+    if(!die->die_haschildren || shares_children(die))
+        return;
+
+    for(uint32_t idx=0; idx<die->die_numchildren; idx++){
+        die_t *child = &die->die_children[idx];
+
+        die_tree_index(dwarfinfo, cu, child);
+    }
+}
+
 void die_display(die_t *die){
     describe_die_internal(die, 0);
 }
 
+/* Anonymous types and lexical blocks are named by
+ * die_tree_name_generated_dies, in whatever order trees get built.
+ */
+int die_has_generated_name(die_t *die){
+    return die->die_anon || die->die_lexblock;
+}
+
 void die_display_die_tree_starting_from(die_t *die){
     display_die_tree_internal(die, 0);
 }
@@ -1485,34 +2047,31 @@ void die_tree_free(Dwarf_Debug dbg, die_t *die, int level){
     if(!die)
         return;
 
-    int critical = 1;
-    die_free(dbg, die, critical);
+    /* The DIEs themselves live in the arena, it has to go last */
+    struct die_unitinfo *ui = get_unitinfo(die);
+    struct arena *arena = ui ? ui->ui_arena : NULL;
 
-    if(!die->die_haschildren)
-        return;
-    else{
-        int idx = 0;
-        die_t *child = die->die_children[idx];
+    die_free(die);
+
+    if(die->die_haschildren && !shares_children(die)){
+        for(uint32_t idx=0; idx<die->die_numchildren; idx++){
+            die_t *child = &die->die_children[idx];
 
-        while(child){
             die_tree_free(dbg, child, level+1);
-            free(die->die_children[idx]);
-            die->die_children[idx] = NULL;
-            child = die->die_children[++idx];
         }
-
-        free(die->die_children);
-        die->die_children = NULL;
     }
+
+    if(level == 0)
+        arena_free(arena);
 }
 
 #define INDENT_INCRE (2)
 
 static int create_array_desc(die_t *die, char **desc, int curdimnum,
         int indent){
-    struct arrdim *curdim = die->die_arrdims[curdimnum];
+    const struct arrdim *curdim = &die->die_type->ti_arrdims[curdimnum];
 
-    if(curdimnum == die->die_arrdimslen-1){
+    if(curdimnum == die->die_type->ti_arrdimslen-1){
         for(int i=0; i<curdim->sz; i++)
             concat(desc, "%*s[%d] = [value here]\n", indent, "", i);
 
@@ -1528,23 +2087,23 @@ static int create_array_desc(die_t *die, char **desc, int curdimnum,
     return 0;
 }
 
-int die_create_variable_or_parameter_desc(die_t *die, void *cu_root_die,
+int die_create_variable_or_parameter_desc(die_t *die, void *cu,
         char **desc, sym_error_t *e, int indent){
     if(!die)
         return 0;
 
-    if(!(die->die_datatypeclass & DTC_POINTER)){
-        if(die->die_datatypeclass & DTC_STRUCT ||
-                die->die_datatypeclass & DTC_UNION){
+    if(!(die->die_type->ti_datatypeclass & DTC_POINTER)){
+        if(die->die_type->ti_datatypeclass & DTC_STRUCT ||
+                die->die_type->ti_datatypeclass & DTC_UNION){
             die_t **members = NULL;
             int len = 0;
 
-            die_get_members(die, cu_root_die, &members, &len, e);
+            die_get_members(die, cu, &members, &len, e);
 
-            char *typename = die->die_datatypename;
+            const char *typename = die->die_type->ti_datatypename;
             
             if(!typename){
-                if(die->die_datatypeclass & DTC_STRUCT)
+                if(die->die_type->ti_datatypeclass & DTC_STRUCT)
                     typename = "(anonymous struct)";
                 else
                     typename = "(anonymous union)";
@@ -1554,7 +2113,7 @@ int die_create_variable_or_parameter_desc(die_t *die, void *cu_root_die,
                     indent, "", typename, die->die_diename);
 
             for(int i=0; i<len; i++){
-                die_create_variable_or_parameter_desc(members[i], cu_root_die,
+                die_create_variable_or_parameter_desc(members[i], cu,
                         desc, e, indent+INDENT_INCRE);
                 concat(desc, "\n");
             }
@@ -1567,19 +2126,19 @@ int die_create_variable_or_parameter_desc(die_t *die, void *cu_root_die,
         }
     }
 
-    if(die->die_datatypeclass & DTC_ARRAY){
+    if(die->die_type->ti_datatypeclass & DTC_ARRAY){
         concat(desc, "%*s(%s) %s = {\n",
-                indent, "", die->die_datatypename, die->die_diename);
+                indent, "", die->die_type->ti_datatypename, die->die_diename);
         create_array_desc(die, desc, 0, indent+INDENT_INCRE);
         concat(desc, "%*s}", indent, "");
 
         return 0;
     }
 
-    if(die->die_datatypeclass & DTC_POINTER ||
-            die->die_datatypeclass & DTC_OTHER){
+    if(die->die_type->ti_datatypeclass & DTC_POINTER ||
+            die->die_type->ti_datatypeclass & DTC_OTHER){
         concat(desc, "%*s(%s) %s = [value here]",
-                indent, "", die->die_datatypename, die->die_diename);
+                indent, "", die->die_type->ti_datatypename, die->die_diename);
     }
 
     return 0;
@@ -1598,13 +2157,13 @@ int die_evaluate_location_description(die_t *die, uint64_t pc,
     }
 
     /* Iterate over all the location lists until we find the right one. */
-    for(Dwarf_Signed i=0; i<die->die_loclistcnt; i++){
-        void *current = die->die_loclists[i];
+    for(Dwarf_Signed i=0; i<die->die_loc->li_loclistcnt; i++){
+        void *current = die->die_loc->li_loclists[i];
 
         if(current && !is_locdesc_in_bounds(current, pc))
             continue;
 
-        char *s = decode_location_description(die->die_framebaselocdesc,
+        char *s = decode_location_description(die->die_loc->li_framebase,
                 current, pc, resultout);
         free(s);
         break;
@@ -1624,7 +2183,7 @@ int die_get_array_elem_size(die_t *die, uint64_t *elemszout, sym_error_t *e){
         return 1;
     }
 
-    *elemszout = die->die_arrmembsz;
+    *elemszout = die->die_type->ti_arrmembsz;
     return 0;
 }
 
@@ -1640,7 +2199,7 @@ int die_get_array_size_determined_at_runtime(die_t *die, int *retval,
         return 1;
     }
 
-    *retval = die->die_databytessize == NON_COMPILE_TIME_CONSTANT_SIZE;
+    *retval = die->die_type->ti_databytessize == NON_COMPILE_TIME_CONSTANT_SIZE;
     return 0;
 }
 
@@ -1655,12 +2214,12 @@ int die_get_data_type_str(die_t *die, char **datatypeout, sym_error_t *e){
         return 1;
     }
 
-    if(!die->die_datatypename){
+    if(!die->die_type->ti_datatypename){
         errset(e, DIE_ERROR_KIND, DIE_NO_DATA_TYPE_NAME);
         return 1;
     }
 
-    strncpy(*datatypeout, die->die_datatypename, strlen(die->die_datatypename));
+    strncpy(*datatypeout, die->die_type->ti_datatypename, strlen(die->die_type->ti_datatypename));
 
     return 0;
 }
@@ -1676,7 +2235,7 @@ int die_get_encoding(die_t *die, uint64_t *encodingout, sym_error_t *e){
         return 1;
     }
 
-    *encodingout = die->die_datatypeencoding;
+    *encodingout = die->die_type->ti_datatypeencoding;
     return 0;
 }
 
@@ -1695,110 +2254,104 @@ int die_get_high_pc(die_t *die, uint64_t *highpcout, sym_error_t *e){
     return 0;
 }
 
-static char *get_dwarf_line_filename(Dwarf_Debug dbg, Dwarf_Line line){
-    if(!line)
-        return NULL;
-
-    Dwarf_Error d_error = NULL;
-    char *filename = NULL;
-
-    int ret = dwarf_linesrc(line, &filename, &d_error);
-
-    if(ret == DW_DLV_ERROR){
-        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
-        return NULL;
+/* The function is NULL if no function DIE covers pc, like code from
+ * an assembler, which gets a line table but no DW_TAG_subprogram.
+ */
+int die_get_line_info_from_pc(Dwarf_Debug dbg, die_t *die, uint64_t pc,
+        char **srcfilename, char **srcfunction, uint64_t *srclineno,
+        sym_error_t *e){
+    if(!die){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_DIE);
+        return 1;
     }
 
-    return filename;
-}
-
-static Dwarf_Unsigned get_dwarf_line_lineno(Dwarf_Debug dbg, Dwarf_Line line){
-    if(!line)
-        return 0;
-
-    Dwarf_Error d_error = NULL;
-    Dwarf_Unsigned lineno = 0;
+    /* Not a compilation unit DIE */
+    if(!die_is_unit_root(die)){
+        errset(e, DIE_ERROR_KIND, DIE_NOT_COMPILE_UNIT_DIE);
+        return 1;
+    }
 
-    int ret = dwarf_lineno(line, &lineno, &d_error);
+    int row = linetable_find_row_exact(die->die_unit->ui_linetable, pc);
 
-    if(ret == DW_DLV_ERROR){
-        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
-        return 0;
+    if(row == -1){
+        errset(e, DIE_ERROR_KIND, DIE_COULD_NOT_GET_LINE_INFO);
+        return 1;
     }
 
-    return lineno;
-}
+    const char *fname = NULL;
+    linetable_get_row(die->die_unit->ui_linetable, row, NULL, srclineno, &fname);
 
-static Dwarf_Addr get_dwarf_line_virtual_addr(Dwarf_Debug dbg, Dwarf_Line line){
-    if(!line)
-        return 0;
+    /* We are only interested in the file name */
+    char *slash = strrchr(fname, '/');
 
-    Dwarf_Error d_error = NULL;
-    Dwarf_Addr lineaddr = 0;
+    if(slash)
+        *srcfilename = strdup(slash + 1);
+    else
+        *srcfilename = strdup(fname);
 
-    int ret = dwarf_lineaddr(line, &lineaddr, &d_error);
+    die_t *fxndie = NULL;
+    int ret = die_search(die, (void *)pc, DIE_SEARCH_FUNCTION_BY_PC,
+            &fxndie, NULL);
 
-    if(ret == DW_DLV_ERROR){
-        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+    if(ret || !fxndie->die_diename){
+        *srcfunction = NULL;
         return 0;
     }
 
-    return lineaddr;
+    *srcfunction = strdup(fxndie->die_diename);
+
+    return 0;
 }
 
-int die_get_line_info_from_pc(Dwarf_Debug dbg, die_t *die, uint64_t pc,
-        char **srcfilename, char **srcfunction, uint64_t *srclineno,
-        sym_error_t *e){
+/* die_get_line_info_from_pc for pcs in ascending order, all in the
+ * compilation unit whose root DIE is die. Unlike it, a PC doesn't have
+ * to start a row, and nothing is copied. A file name is NULL and its
+ * line 0 if the line table doesn't cover that PC, a function is NULL
+ * if no function DIE does.
+ */
+int die_get_line_info_from_sorted_pcs(die_t *die, const uint64_t *pcs,
+        int n, const char **filenamesout, uint64_t *linenosout,
+        die_t **fxndiesout, sym_error_t *e){
     if(!die){
         errset(e, GENERIC_ERROR_KIND, GE_INVALID_DIE);
         return 1;
     }
 
-    /* Not a compilation unit DIE */
-    if(die->die_tag != DW_TAG_compile_unit){
+    if(!die_is_unit_root(die)){
         errset(e, DIE_ERROR_KIND, DIE_NOT_COMPILE_UNIT_DIE);
         return 1;
     }
 
-    for(Dwarf_Signed i=0; i<die->die_srclinescnt; i++){
-        Dwarf_Line line = die->die_srclines[i];
-
-        if(pc == get_dwarf_line_virtual_addr(dbg, line)){
-            char *fname = get_dwarf_line_filename(dbg, line);
-
-            /* We are only interested in the file name */
-            if(fname){
-                char *slash = strrchr(fname, '/');
+    void *lt = die->die_unit->ui_linetable;
+    int *rows = malloc(sizeof(int) * (n ? n : 1));
 
-                if(slash)
-                    *srcfilename = strdup(slash + 1);
-                else
-                    *srcfilename = strdup(fname);
-
-                dwarf_dealloc(dbg, fname, DW_DLA_STRING);
-            }
+    linetable_find_rows_containing(lt, pcs, n, rows);
 
-            *srclineno = get_dwarf_line_lineno(dbg, line);
+    for(int i=0; i<n; i++){
+        filenamesout[i] = NULL;
+        linenosout[i] = 0;
 
-            die_t *fxndie = NULL;
-            int ret = die_search(die, (void *)pc, DIE_SEARCH_FUNCTION_BY_PC,
-                    &fxndie, e);
+        if(rows[i] != -1){
+            const char *fname = NULL;
+            linetable_get_row(lt, rows[i], NULL, &linenosout[i], &fname);
 
-            if(ret){
-                free(*srcfilename);
-                *srcfilename = NULL;
-                *srclineno = 0;
-                return 1;
-            }
-
-            *srcfunction = strdup(fxndie->die_diename);
+            const char *slash = fname ? strrchr(fname, '/') : NULL;
+            filenamesout[i] = slash ? slash + 1 : fname;
+        }
 
-            return 0;
+        if(i > 0 && pcs[i] == pcs[i - 1]){
+            fxndiesout[i] = fxndiesout[i - 1];
+            continue;
         }
+
+        fxndiesout[i] = NULL;
+        die_search(die, (void *)pcs[i], DIE_SEARCH_FUNCTION_BY_PC,
+                &fxndiesout[i], NULL);
     }
 
-    errset(e, DIE_ERROR_KIND, DIE_COULD_NOT_GET_LINE_INFO);
-    return 1;
+    free(rows);
+
+    return 0;
 }
 
 int die_get_low_pc(die_t *die, uint64_t *lowpcout, sym_error_t *e){
@@ -1816,7 +2369,7 @@ int die_get_low_pc(die_t *die, uint64_t *lowpcout, sym_error_t *e){
     return 0;
 }
 
-int die_get_members(die_t *die, die_t *cu_root_die,
+int die_get_members(die_t *die, void *cu,
         die_t ***membersout, int *len, sym_error_t *e){
     if(!die){
         errset(e, GENERIC_ERROR_KIND, GE_INVALID_DIE);
@@ -1833,8 +2386,8 @@ int die_get_members(die_t *die, die_t *cu_root_die,
 
     if(tag != DW_TAG_structure_type && tag != DW_TAG_union_type){
         die_t *d = NULL;
-        if(die_search(cu_root_die, (void *)die->die_basedatatypedieoffset,
-                    DIE_SEARCH_IF_DIE_OFFSET_MATCHES, &d, e)){
+        if(cu_find_die_by_offset(cu, die->die_type->ti_basedatatypedieoffset,
+                    (void **)&d, e)){
             errset(e, DIE_ERROR_KIND, DIE_NOT_STRUCT_OR_UNION);
             return 1;
         }
@@ -1845,17 +2398,15 @@ int die_get_members(die_t *die, die_t *cu_root_die,
     die_t **members = malloc(sizeof(die_t));
     members[0] = NULL;
 
-    int idx = 0;
-    die_t *child = target->die_children[idx];
+    for(uint32_t idx=0; idx<target->die_numchildren; idx++){
+        die_t *child = &target->die_children[idx];
 
-    while(child){
         if(child->die_tag == DW_TAG_member){
             die_t **members_rea = realloc(members, sizeof(die_t) * ++(*len));
             members = members_rea;
             members[(*len) - 1] = child;
         }
 
-        child = target->die_children[++idx];
     }
 
     *membersout = members;
@@ -1874,7 +2425,7 @@ int die_get_name(die_t *die, char **dienameout, sym_error_t *e){
         return 1;
     }
 
-    *dienameout = die->die_diename;
+    *dienameout = (char *)die->die_diename;
     return 0;
 }
 
@@ -1916,17 +2467,15 @@ int die_get_parameters(die_t *die, die_t ***paramsout, int *lenout,
     die_t **params = malloc(sizeof(die_t));
     params[0] = NULL;
 
-    int idx = 0;
-    die_t *child = die->die_children[idx];
+    for(uint32_t idx=0; idx<die->die_numchildren; idx++){
+        die_t *child = &die->die_children[idx];
 
-    while(child){
         if(child->die_tag == DW_TAG_formal_parameter){
             die_t **params_rea = realloc(params, sizeof(die_t) * ++(*lenout));
             params = params_rea;
             params[(*lenout) - 1] = child;
         }
 
-        child = die->die_children[++idx];
     }
 
     *paramsout = params;
@@ -1956,7 +2505,7 @@ int die_get_pc_of_next_line(Dwarf_Debug dbg, die_t *die,
     }
 
     /* Not a compilation unit DIE */
-    if(die->die_tag != DW_TAG_compile_unit){
+    if(!die_is_unit_root(die)){
         errset(e, DIE_ERROR_KIND, DIE_NOT_COMPILE_UNIT_DIE);
         return 1;
     }
@@ -1966,40 +2515,20 @@ int die_get_pc_of_next_line(Dwarf_Debug dbg, die_t *die,
         return 1;
     }
 
-    uint64_t next_line = 0, start_pc_lineno = 0;
+    uint64_t start_pc_lineno = 0;
 
     if(die_pc_to_lineno(dbg, die, start_pc, &start_pc_lineno, e))
         return 1;
 
-    Dwarf_Unsigned prevlineno = start_pc_lineno;
-
-    /* Lines given back aren't guarenteed to be in chronological order. */
-    for(Dwarf_Signed i=0; i<die->die_srclinescnt; i++){
-        Dwarf_Line line = die->die_srclines[i];
-        Dwarf_Unsigned curlineaddr = get_dwarf_line_virtual_addr(dbg, line);
-        Dwarf_Unsigned curlineno = get_dwarf_line_lineno(dbg, line);
-
-        if(curlineaddr <= start_pc || curlineno == 0 ||
-                start_pc_lineno == curlineno){
-            continue;
-        }
-        
-        uint64_t current = llabs((int64_t)(next_line - start_pc));
-        uint64_t diff = llabs((int64_t)(curlineaddr - start_pc));
-
-        if(diff < current && prevlineno != curlineno)
-            next_line = curlineaddr;
-
-        prevlineno = curlineno;
-    }
+    int row = linetable_find_next_line_row(die->die_unit->ui_linetable, start_pc,
+            start_pc_lineno);
 
-    /* If this is still 0, the next line's PC wasn't found. */
-    if(next_line == 0){
+    if(row == -1){
         errset(e, DIE_ERROR_KIND, DIE_NEXT_LINE_NOT_FOUND);
         return 1;
     }
 
-    *next_line_pc = next_line;
+    linetable_get_row(die->die_unit->ui_linetable, row, next_line_pc, NULL, NULL);
     return 0;
 }
 
@@ -2010,21 +2539,35 @@ int die_get_pc_values_from_lineno(Dwarf_Debug dbg, die_t *die,
         return 1;
     }
 
-    *pcs = malloc(sizeof(uint64_t));
-    (*pcs)[0] = 0;
+    linetable_get_pcs_for_line(die->die_unit->ui_linetable, lineno, pcs, len);
 
-    for(Dwarf_Signed i=0; i<die->die_srclinescnt; i++){
-        Dwarf_Line line = die->die_srclines[i];
-        Dwarf_Unsigned curlineaddr = get_dwarf_line_virtual_addr(dbg, line);
-        Dwarf_Unsigned curlineno = get_dwarf_line_lineno(dbg, line);
+    return 0;
+}
 
-        if(curlineno == lineno){
-            uint64_t *pcs_rea = realloc(*pcs, sizeof(uint64_t) * ++(*len));
-            *pcs = pcs_rea;
-            (*pcs)[(*len) - 1] = curlineaddr;
-        }
+/* Same, but only lines from file, which can be a full path or the end
+ * of one, so a header's lines aren't mixed in with its includer's.
+ */
+int die_get_pc_values_from_file_lineno(Dwarf_Debug dbg, die_t *die,
+        const char *file, uint64_t lineno, uint64_t **pcs, int *len,
+        sym_error_t *e){
+    if(!die){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_DIE);
+        return 1;
+    }
+
+    if(!die_is_unit_root(die)){
+        errset(e, DIE_ERROR_KIND, DIE_NOT_COMPILE_UNIT_DIE);
+        return 1;
     }
 
+    if(!file || !pcs || !len){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_PARAMETER);
+        return 1;
+    }
+
+    linetable_get_pcs_for_file_line(die->die_unit->ui_linetable, file,
+            lineno, pcs, len);
+
     return 0;
 }
 
@@ -2045,14 +2588,12 @@ int die_get_variables(Dwarf_Debug dbg, die_t *die, die_t ***vardies,
     if(!die->die_haschildren)
         return 0;
     else{
-        int idx = 0;
-        die_t *child = die->die_children[idx];
-
         int ret = 0;
 
-        while(child){
+        for(uint32_t idx=0; idx<die->die_numchildren; idx++){
+            die_t *child = &die->die_children[idx];
+
             ret = die_get_variables(dbg, child, vardies, len);
-            child = die->die_children[++idx];
         }
 
         return ret;
@@ -2072,7 +2613,7 @@ int die_get_variable_size(die_t *die, uint64_t *sizeout, sym_error_t *e){
         return 1;
     }
 
-    *sizeout = die->die_databytessize;
+    *sizeout = die->die_type->ti_databytessize;
     return 0;
 }
 
@@ -2108,7 +2649,7 @@ int die_lineno_to_pc(Dwarf_Debug dbg, die_t *die, uint64_t *lineno,
         return 1;
     }
 
-    if(die->die_tag != DW_TAG_compile_unit){
+    if(!die_is_unit_root(die)){
         errset(e, DIE_ERROR_KIND, DIE_NOT_COMPILE_UNIT_DIE);
         return 1;
     }
@@ -2121,34 +2662,25 @@ int die_lineno_to_pc(Dwarf_Debug dbg, die_t *die, uint64_t *lineno,
     /* Find the closest line to lineno. Sometimes the source file does
      * not accurately reflect the compiled program.
      */
-    uint64_t closestlineno = 0;
-    Dwarf_Line closestline = NULL;
-
+    uint64_t closestlineno = 0, closestpc = 0;
     uint64_t linepassedin = *lineno;
 
-    for(Dwarf_Signed i=0; i<die->die_srclinescnt; i++){
-        Dwarf_Line line = die->die_srclines[i];
-        Dwarf_Unsigned curlineno = get_dwarf_line_lineno(dbg, line);
+    if(linetable_find_nearest_line(die->die_unit->ui_linetable, linepassedin,
+                &closestlineno, &closestpc)){
+        errset(e, DIE_ERROR_KIND, DIE_LINE_NOT_FOUND);
+        return 1;
+    }
 
-        uint64_t current = llabs((int64_t)(closestlineno - linepassedin));
-        uint64_t diff = llabs((int64_t)(curlineno - linepassedin));
+    *pcout = closestpc;
 
-        /* exact match */
-        if(diff == 0){
-            *pcout = get_dwarf_line_virtual_addr(dbg, line);
-            return 0;
-        }
-        else if(diff < current){
-            closestlineno = curlineno;
-            closestline = line;
-        }
-    }
+    /* exact match */
+    if(closestlineno == linepassedin)
+        return 0;
 
     // XXX concat(outbuffer, ...
     printf("Line %lld doesn't exist, auto-adjusted to line %lld\n",
             linepassedin, closestlineno);
 
-    *pcout = get_dwarf_line_virtual_addr(dbg, closestline);
     *lineno = closestlineno;
 
     return 0;
@@ -2161,7 +2693,7 @@ int die_pc_to_lineno(Dwarf_Debug dbg, die_t *die, uint64_t target_pc,
         return 1;
     }
 
-    if(die->die_tag != DW_TAG_compile_unit){
+    if(!die_is_unit_root(die)){
         errset(e, DIE_ERROR_KIND, DIE_NOT_COMPILE_UNIT_DIE);
         return 1;
     }
@@ -2172,18 +2704,15 @@ int die_pc_to_lineno(Dwarf_Debug dbg, die_t *die, uint64_t target_pc,
     }
 
     /* If we're given a PC to match against, we should match exactly. */
-    for(Dwarf_Signed i=0; i<die->die_srclinescnt; i++){
-        Dwarf_Line line = die->die_srclines[i];
-        Dwarf_Unsigned curlineaddr = get_dwarf_line_virtual_addr(dbg, line);
+    int row = linetable_find_row_exact(die->die_unit->ui_linetable, target_pc);
 
-        if(target_pc == curlineaddr){
-            *lineno = get_dwarf_line_lineno(dbg, line);
-            return 0;
-        }
+    if(row == -1){
+        errset(e, DIE_ERROR_KIND, DIE_LINE_NOT_FOUND);
+        return 1;
     }
 
-    errset(e, DIE_ERROR_KIND, DIE_LINE_NOT_FOUND);
-    return 1;
+    linetable_get_row(die->die_unit->ui_linetable, row, NULL, lineno, NULL);
+    return 0;
 }
 
 static int die_is_func_in_range(die_t *die, void *pc){
@@ -2212,20 +2741,187 @@ static void die_search_internal(die_t *die, void *data,
     if(!die->die_haschildren)
         return;
     else{
-        int idx = 0;
-        die_t *child = die->die_children[idx];
+        for(uint32_t idx=0; idx<die->die_numchildren; idx++){
+            die_t *child = &die->die_children[idx];
 
-        while(child){
             die_search_internal(child, data, comparefxn, out);
-            child = die->die_children[++idx];
         }
     }
 }
 
+static int fxnrange_cmp(const void *a, const void *b){
+    const struct fxnrange *fa = a, *fb = b;
+
+    if(fa->fr_low != fb->fr_low)
+        return fa->fr_low < fb->fr_low ? -1 : 1;
+
+    if(fa->fr_high != fb->fr_high)
+        return fa->fr_high > fb->fr_high ? -1 : 1;
+
+    return 0;
+}
+
+static void add_index_range(struct fxnindex *index, int *capacity,
+        Dwarf_Unsigned low, Dwarf_Unsigned high, die_t *die){
+    if(index->fi_len == *capacity){
+        *capacity = *capacity ? *capacity * 2 : 64;
+
+        struct fxnrange *ranges_rea = realloc(index->fi_ranges,
+                sizeof(struct fxnrange) * (*capacity));
+        index->fi_ranges = ranges_rea;
+    }
+
+    struct fxnrange *r = &index->fi_ranges[index->fi_len++];
+    r->fr_low = low;
+    r->fr_high = high;
+    r->fr_parent = -1;
+    r->fr_die = die;
+}
+
+static void collect_function_ranges(die_t *die, struct fxnindex *index,
+        int *capacity){
+    if(die->die_tag == DW_TAG_subprogram &&
+            die->die_low_pc < die->die_high_pc){
+        add_index_range(index, capacity, die->die_low_pc, die->die_high_pc,
+                die);
+    }
+
+    if(!die->die_haschildren)
+        return;
+
+    for(uint32_t idx=0; idx<die->die_numchildren; idx++){
+        die_t *child = &die->die_children[idx];
+
+        collect_function_ranges(child, index, capacity);
+    }
+}
+
+static void collect_inline_ranges(die_t *die, struct fxnindex *index,
+        int *capacity){
+    if(die->die_inlinedsub){
+        const struct die_inlineinfo *ii = die->die_inline;
+
+        for(int i=0; i<ii->ii_numranges; i++){
+            add_index_range(index, capacity, ii->ii_ranges[i].ir_low,
+                    ii->ii_ranges[i].ir_high, die);
+        }
+
+        if(ii->ii_numranges == 0 && die->die_low_pc < die->die_high_pc){
+            add_index_range(index, capacity, die->die_low_pc,
+                    die->die_high_pc, die);
+        }
+    }
+
+    if(!die->die_haschildren)
+        return;
+
+    for(uint32_t idx=0; idx<die->die_numchildren; idx++){
+        die_t *child = &die->die_children[idx];
+
+        collect_inline_ranges(child, index, capacity);
+    }
+}
+
+static void link_index_ranges(struct fxnindex *index){
+    if(index->fi_len == 0)
+        return;
+
+    qsort(index->fi_ranges, index->fi_len, sizeof(struct fxnrange),
+            fxnrange_cmp);
+
+    /* Figure out which range encloses each one. Anything still on
+     * the stack when we see a range starts at or before it, so the
+     * closest one that also ends after it is its parent.
+     */
+    int *stack = malloc(sizeof(int) * index->fi_len);
+    int top = -1;
+
+    for(int i=0; i<index->fi_len; i++){
+        struct fxnrange *r = &index->fi_ranges[i];
+
+        while(top >= 0 && index->fi_ranges[stack[top]].fr_high < r->fr_high)
+            top--;
+
+        if(top >= 0 && index->fi_ranges[stack[top]].fr_high > r->fr_low)
+            r->fr_parent = stack[top];
+
+        stack[++top] = i;
+    }
+
+    free(stack);
+}
+
+static struct fxnindex *build_function_index(die_t *root_die){
+    struct fxnindex *index = calloc(1, sizeof(struct fxnindex));
+    int capacity = 0;
+
+    collect_function_ranges(root_die, index, &capacity);
+    link_index_ranges(index);
+
+    return index;
+}
+
+/* Inlined subroutines nest inside each other and their subprogram the
+ * same way subprograms can, so the same index finds the innermost
+ * one. Since DIE trees nest the same way, the rest of the chain is its
+ * ancestors.
+ */
+static struct fxnindex *build_inline_index(die_t *root_die){
+    struct fxnindex *index = calloc(1, sizeof(struct fxnindex));
+    int capacity = 0;
+
+    collect_inline_ranges(root_die, index, &capacity);
+    link_index_ranges(index);
+
+    return index;
+}
+
+/* Find the innermost function containing pc. The last range to start
+ * at or before pc is either it, or nested inside of it, so we only
+ * have to walk up from there.
+ */
+static die_t *function_index_lookup(struct fxnindex *index, uint64_t pc){
+    int lo = 0, hi = index->fi_len - 1, found = -1;
+
+    while(lo <= hi){
+        int mid = lo + ((hi - lo) / 2);
+
+        if(index->fi_ranges[mid].fr_low <= pc){
+            found = mid;
+            lo = mid + 1;
+        }
+        else{
+            hi = mid - 1;
+        }
+    }
+
+    while(found != -1 && pc >= index->fi_ranges[found].fr_high)
+        found = index->fi_ranges[found].fr_parent;
+
+    if(found == -1)
+        return NULL;
+
+    return index->fi_ranges[found].fr_die;
+}
+
 int die_search(die_t *start, void *data, int way, die_t **out,
         sym_error_t *e){
     int (*comparefxn)(die_t *, void *) = NULL;
 
+    /* Compilation unit DIEs have an index for this */
+    struct die_unitinfo *ui = start ? get_unitinfo(start) : NULL;
+
+    if(way == DIE_SEARCH_FUNCTION_BY_PC && ui && ui->ui_fxnindex){
+        *out = function_index_lookup(ui->ui_fxnindex, (uint64_t)data);
+
+        if(!(*out)){
+            errset(e, DIE_ERROR_KIND, DIE_DIE_NOT_FOUND);
+            return 1;
+        }
+
+        return 0;
+    }
+
     if(way == DIE_SEARCH_IF_NAME_MATCHES)
         comparefxn = die_name_matches;
     else if(way == DIE_SEARCH_FUNCTION_BY_PC)
@@ -2243,43 +2939,269 @@ int die_search(die_t *start, void *data, int way, die_t **out,
     return 0;
 }
 
-int initialize_and_build_die_tree_from_root_die(dwarfinfo_t *dwarfinfo,
-        void *compile_unit, die_t **_root_die, sym_error_t *e){
+static const char *basename_of(const char *path){
+    const char *slash = path ? strrchr(path, '/') : NULL;
+
+    return slash ? slash + 1 : path;
+}
+
+static const char *inline_call_file(struct die_unitinfo *ui,
+        const struct die_inlineinfo *ii){
+    Dwarf_Unsigned idx = ii->ii_callfile;
+
+    if(ui->ui_version < 5){
+        if(idx == 0)
+            return NULL;
+
+        idx--;
+    }
+
+    if(idx >= (Dwarf_Unsigned)ui->ui_numsrcfiles)
+        return NULL;
+
+    return basename_of(ui->ui_srcfiles[idx]);
+}
+
+/* An inlined subroutine's name is on the subprogram it's a copy of */
+static const char *inline_function_name(void *compile_unit, die_t *die){
+    die_t *origin = NULL;
+
+    if(cu_find_die_by_offset(compile_unit, die->die_inline->ii_aboriginoff,
+                (void **)&origin, NULL)){
+        return NULL;
+    }
+
+    return origin->die_diename;
+}
+
+/* Every function pc is in, innermost first: inlined subroutines, then
+ * the subprogram they were all inlined into. The array must be freed,
+ * the names in it must not.
+ */
+int die_get_inlined_frames_from_pc(die_t *die, void *compile_unit,
+        uint64_t pc, sym_inlineframe_t **framesout, int *lenout,
+        sym_error_t *e){
+    if(!die){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_DIE);
+        return 1;
+    }
+
+    if(!framesout || !lenout){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_PARAMETER);
+        return 1;
+    }
+
+    struct die_unitinfo *ui = get_unitinfo(die);
+
+    if(!ui || !die_is_unit_root(die)){
+        errset(e, DIE_ERROR_KIND, DIE_NOT_COMPILE_UNIT_DIE);
+        return 1;
+    }
+
+    die_t *innermost = NULL;
+
+    if(ui->ui_inlineindex)
+        innermost = function_index_lookup(ui->ui_inlineindex, pc);
+
+    if(!innermost && ui->ui_fxnindex)
+        innermost = function_index_lookup(ui->ui_fxnindex, pc);
+
+    if(!innermost){
+        errset(e, DIE_ERROR_KIND, DIE_DIE_NOT_FOUND);
+        return 1;
+    }
+
+    int len = 0;
+
+    for(die_t *d=innermost; d; d=d->die_parent){
+        if(d->die_inlinedsub)
+            len++;
+        else if(d->die_tag == DW_TAG_subprogram){
+            len++;
+            break;
+        }
+    }
+
+    sym_inlineframe_t *frames = calloc(len, sizeof(sym_inlineframe_t));
+
+    /* The innermost frame is wherever the line table says pc is, the
+     * rest are wherever the frame inside them was inlined.
+     */
+    int row = linetable_find_row_containing(ui->ui_linetable, pc);
+
+    if(row != -1){
+        const char *fname = NULL;
+        linetable_get_row(ui->ui_linetable, row, NULL,
+                &frames[0].srcfilelineno, &fname);
+        frames[0].srcfilename = basename_of(fname);
+    }
+
+    int idx = 0;
+
+    for(die_t *d=innermost; d && idx<len; d=d->die_parent){
+        sym_inlineframe_t *frame = &frames[idx];
+
+        if(d->die_inlinedsub){
+            frame->srcfunction = inline_function_name(compile_unit, d);
+            frame->callfilename = inline_call_file(ui, d->die_inline);
+            frame->calllineno = d->die_inline->ii_callline;
+        }
+        else if(d->die_tag == DW_TAG_subprogram)
+            frame->srcfunction = d->die_diename;
+        else
+            continue;
+
+        if(idx + 1 < len){
+            frames[idx + 1].srcfilename = frame->callfilename;
+            frames[idx + 1].srcfilelineno = frame->calllineno;
+        }
+
+        idx++;
+    }
+
+    *framesout = frames;
+    *lenout = len;
+
+    return 0;
+}
+
+/* For a split unit, dbg is its split object and skeleton_dbg and
+ * skeleton_die_offset say where its skeleton unit is, which has the
+ * line table. Otherwise, skeleton_dbg is NULL.
+ */
+int initialize_and_build_die_tree_from_root_die(Dwarf_Debug dbg,
+        void *compile_unit, Dwarf_Off cu_die_offset, Dwarf_Debug skeleton_dbg,
+        Dwarf_Off skeleton_die_offset, die_t **_root_die, sym_error_t *e){
     int is_info = 1;
     Dwarf_Error d_error = NULL;
     Dwarf_Die cu_rootdie = NULL;
 
-    int ret = dwarf_siblingof_b(dwarfinfo->di_dbg, NULL, is_info,
+    /* Go by offset instead of relying on whichever compilation unit
+     * libdwarf last saw a header for, the tree may be built long
+     * after all the headers were read.
+     */
+    int ret = dwarf_offdie_b(dbg, cu_die_offset, is_info,
             &cu_rootdie, &d_error);
 
-    if(ret == DW_DLV_ERROR){
-        errset(e, SYM_ERROR_KIND, SYM_DWARF_SIBLING_OF_B_FAILED);
+    if(ret != DW_DLV_OK){
+        if(ret == DW_DLV_ERROR)
+            dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+
+        errset(e, SYM_ERROR_KIND, SYM_DWARF_OFFDIE_FAILED);
         return 1;
     }
 
-    die_t *root_die = create_new_die(dwarfinfo, compile_unit, cu_rootdie, 0);
+    struct arena *arena = arena_new(DIE_ARENA_CHUNK_SIZE);
+    struct arena *scratch = arena_new(DIE_ARENA_CHUNK_SIZE);
+
+    CUR_ARENA = arena;
+    CUR_SCRATCH = scratch;
+    CUR_STRTAB = cu_get_strtab(compile_unit);
+    CUR_NUMNODES = 0;
+
     memset(CUR_PARENTS, 0, sizeof(CUR_PARENTS));
-    CUR_PARENTS[0] = root_die;
 
-     //if(strcmp(root_die->die_diename, "source/cmd/memcmd.c") != 0)
-       //return 0;
+    struct buildnode *root = new_buildnode(dbg, compile_unit, cu_rootdie, 0);
+    CUR_PARENTS[0] = root;
 
-    construct_die_tree(dwarfinfo, compile_unit, root_die, 0);
+    construct_die_tree(dbg, compile_unit, cu_rootdie, root, 0);
 
-    ret = dwarf_srclines(root_die->die_dwarfdie, &root_die->die_srclines,
-            &root_die->die_srclinescnt, &d_error);
-    
-    if(ret == DW_DLV_ERROR){
-        dwarf_dealloc(dwarfinfo->di_dbg, d_error, DW_DLA_ERROR);
+    void *typeunify = cu_get_typeunify(compile_unit);
+
+    if(typeunify)
+        unify_types(dbg, typeunify, root);
+
+    Dwarf_Line *srclines = NULL;
+    Dwarf_Signed srclinescnt = 0;
+    Dwarf_Debug linedbg = dbg;
+    Dwarf_Die linedie = cu_rootdie;
+
+    if(skeleton_dbg){
+        linedbg = skeleton_dbg;
+        linedie = NULL;
+
+        ret = dwarf_offdie_b(linedbg, skeleton_die_offset, is_info,
+                &linedie, &d_error);
+
+        if(ret == DW_DLV_ERROR)
+            dwarf_dealloc(linedbg, d_error, DW_DLA_ERROR);
+    }
+
+    int srclinesret = DW_DLV_NO_ENTRY;
+
+    /* DW_AT_call_file indexes these */
+    char **srcfiles = NULL;
+    Dwarf_Signed srcfilescnt = 0;
+    Dwarf_Half version = 0, offset_size = 0;
+
+    if(linedie){
+        srclinesret = dwarf_srclines(linedie, &srclines, &srclinescnt,
+                &d_error);
+
+        if(srclinesret == DW_DLV_ERROR)
+            dwarf_dealloc(linedbg, d_error, DW_DLA_ERROR);
+
+        ret = dwarf_srcfiles(linedie, &srcfiles, &srcfilescnt, &d_error);
+
+        if(ret == DW_DLV_ERROR)
+            dwarf_dealloc(linedbg, d_error, DW_DLA_ERROR);
+
+        dwarf_get_version_of_die(linedie, &version, &offset_size);
+
+        if(linedie != cu_rootdie)
+            dwarf_dealloc(linedbg, linedie, DW_DLA_DIE);
+    }
+
+    /* Deallocates every libdwarf DIE we kept, including cu_rootdie */
+    die_t *root_die = lay_out_die_tree(dbg, root);
+
+    if(typeunify)
+        add_unified_types(typeunify, root);
+
+    memset(CUR_PARENTS, 0, sizeof(CUR_PARENTS));
+    arena_free(scratch);
+
+    CUR_SCRATCH = NULL;
+    CUR_ARENA = NULL;
+    CUR_STRTAB = NULL;
+
+    struct die_unitinfo *ui = arena_alloc(arena, sizeof(struct die_unitinfo));
+    ui->ui_arena = arena;
+    root_die->die_unit = ui;
+
+    ui->ui_version = version;
+
+    if(srcfiles){
+        ui->ui_srcfiles = arena_alloc(arena,
+                sizeof(const char *) * (srcfilescnt ? srcfilescnt : 1));
+        ui->ui_numsrcfiles = srcfilescnt;
+
+        for(Dwarf_Signed i=0; i<srcfilescnt; i++){
+            ui->ui_srcfiles[i] = strtab_intern(cu_get_strtab(compile_unit),
+                    srcfiles[i]);
+            dwarf_dealloc(linedbg, srcfiles[i], DW_DLA_STRING);
+        }
+
+        dwarf_dealloc(linedbg, srcfiles, DW_DLA_LIST);
+    }
+
+    if(srclinesret == DW_DLV_ERROR){
         errset(e, SYM_ERROR_KIND, SYM_DWARF_SRCLINES_FAILED);
+        die_tree_free(dbg, root_die, 0);
         return 1;
     }
 
-    printf("output of display_die_tree:\n\n");
+    /* Decode the line program once, nothing needs libdwarf's
+     * line structures after this.
+     */
+    linetable_new(linedbg, cu_get_strtab(compile_unit), srclines,
+            srclinescnt, &ui->ui_linetable);
 
-    display_die_tree_internal(root_die, 0);
+    if(srclines)
+        dwarf_srclines_dealloc(linedbg, srclines, srclinescnt);
 
-    printf("end display_die_tree output\n\n");
+    ui->ui_fxnindex = build_function_index(root_die);
+    ui->ui_inlineindex = build_inline_index(root_die);
 
     *_root_die = root_die;
 
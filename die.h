@@ -13,6 +13,10 @@ int die_get_encoding(void *, uint64_t *, void *);
 int die_get_high_pc(void *, uint64_t *, void *);
 int die_get_line_info_from_pc(void *, void *, uint64_t, char **, char **,
         uint64_t *, void *);
+int die_get_inlined_frames_from_pc(void *, void *, uint64_t, void **, int *,
+        void *);
+int die_get_line_info_from_sorted_pcs(void *, const uint64_t *, int,
+        const char **, uint64_t *, void **, void *);
 int die_get_low_pc(void *, uint64_t *, void *);
 int die_get_members(void *, void *, void ***, int *, void *);
 int die_get_member_offset(void *, uint64_t *, void *);
@@ -20,10 +24,13 @@ int die_get_name(void *, char **, void *);
 int die_get_parameters(void *, void ***, int *, void *);
 int die_get_parent(void *, void **, void *);
 int die_get_pc_of_next_line(void *, void *, uint64_t, uint64_t *, void *);
+int die_get_pc_values_from_file_lineno(void *, void *, const char *,
+        uint64_t, uint64_t **, int *, void *);
 int die_get_pc_values_from_lineno(void *, void *, uint64_t, uint64_t **,
         int *, void *);
 int die_get_variables(void *, void *, void ***, int *, void *);
 int die_get_variable_size(void *, uint64_t *, void *);
+int die_has_generated_name(void *);
 int die_is_member_of_struct_or_union(void *, int *, void *);
 int die_lineno_to_pc(void *, void *, uint64_t *, uint64_t *, void *);
 int die_pc_to_lineno(void *, void *, uint64_t, uint64_t *, void *);
@@ -33,9 +40,11 @@ int die_represents_struct(void *, int *, void *);
 int die_represents_union(void *, int *, void *);
 int die_search(void *, void *, int, void **, void *);
 void die_tree_free(void *, void *, int);
+void die_tree_index(void *, void *, void *);
+void die_tree_name_generated_dies(void *, void *);
 
 /* Internal functions */
-int initialize_and_build_die_tree_from_root_die(void *, void *, void **,
-        void *);
+int initialize_and_build_die_tree_from_root_die(Dwarf_Debug, void *,
+        Dwarf_Off, Dwarf_Debug, Dwarf_Off, void **, void *);
 
 #endif
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "sym.h"
 
@@ -10,11 +11,19 @@ int main(int argc, char **argv, const char **envp){
     }
 
     char *file = argv[1];
+    int flags = 0;
+
+    for(int i=2; i<argc; i++){
+        if(strcmp(argv[i], "--lazy") == 0)
+            flags |= SYM_INIT_LAZY;
+        else if(strcmp(argv[i], "--parallel") == 0)
+            flags |= SYM_INIT_PARALLEL;
+    }
 
     sym_error_t sym_error = {0};
     void *dwarfinfo = NULL;
 
-    if(sym_init_with_dwarf_file(file, &dwarfinfo, &sym_error))
+    if(sym_init_with_dwarf_file_flags(file, flags, &dwarfinfo, &sym_error))
         printf("error: %s\n", sym_strerror(sym_error));
 
     errclear(&sym_error);
@@ -270,13 +279,19 @@ int main(int argc, char **argv, const char **envp){
                             break;
                         }
 
-                        if(root_die){
+                        if(srcfilename){
                             printf("%#llx: %s:%s:%lld\n",
                                     pc, srcfilename, srcfunction, srcfilelineno);
 
                             free(srcfilename);
                             free(srcfunction);
                         }
+                        else if(srcfunction){
+                            printf("%#llx: %s (no line info)\n",
+                                    pc, srcfunction);
+
+                            free(srcfunction);
+                        }
                         else{
                             printf("\nCouldn't get line info\n");
                         }
@@ -320,7 +335,7 @@ int main(int argc, char **argv, const char **envp){
                             break;
                         }
 
-                        if(root_die){
+                        if(srcfilename){
                             printf("Next line is at %#llx: %s:%s:%lld\n",
                                     next_line_pc, srcfilename, srcfunction, srcfilelineno);
 
@@ -328,6 +343,7 @@ int main(int argc, char **argv, const char **envp){
                             free(srcfunction);
                         }
                         else{
+                            free(srcfunction);
                             printf("\nCouldn't get line info\n");
                         }
 
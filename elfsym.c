@@ -0,0 +1,200 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "elfsym.h"
+
+/* An address index over the function symbols in .symtab and .dynsym,
+ * for PCs no compilation unit covers: assembly, objects built without
+ * -g, and the like. Names point into the string tables, nothing is
+ * copied, so they have to outlive the index.
+ */
+
+#define STT_FUNC (2)
+#define STT_GNU_IFUNC (10)
+#define STB_GLOBAL (1)
+#define SHN_UNDEF (0)
+
+struct elf64_sym {
+    uint32_t st_name;
+    unsigned char st_info;
+    unsigned char st_other;
+    uint16_t st_shndx;
+    uint64_t st_value;
+    uint64_t st_size;
+};
+
+struct elf32_sym {
+    uint32_t st_name;
+    uint32_t st_value;
+    uint32_t st_size;
+    unsigned char st_info;
+    unsigned char st_other;
+    uint16_t st_shndx;
+};
+
+struct elfsymbol {
+    uint64_t es_low;
+    /* Exclusive. For symbols without a size, wherever the next one
+     * starts, see elfsym_finish.
+     */
+    uint64_t es_high;
+    uint64_t es_size;
+    int es_global;
+    const char *es_name;
+};
+
+struct elfsym {
+    struct elfsymbol *es_symbols;
+    int es_len;
+    int es_cap;
+};
+
+struct elfsym *elfsym_new(void){
+    return calloc(1, sizeof(struct elfsym));
+}
+
+void elfsym_free(struct elfsym *es){
+    if(!es)
+        return;
+
+    free(es->es_symbols);
+    free(es);
+}
+
+static void add_symbol(struct elfsym *es, const unsigned char *str,
+        uint64_t strsize, uint32_t name, unsigned char info,
+        uint16_t shndx, uint64_t value, uint64_t size){
+    unsigned char type = info & 0xf;
+
+    if((type != STT_FUNC && type != STT_GNU_IFUNC) || shndx == SHN_UNDEF)
+        return;
+
+    if(name == 0 || name >= strsize ||
+            !memchr(str + name, '\0', strsize - name)){
+        return;
+    }
+
+    if(es->es_len == es->es_cap){
+        es->es_cap = es->es_cap ? es->es_cap * 2 : 256;
+
+        struct elfsymbol *symbols_rea = realloc(es->es_symbols,
+                sizeof(struct elfsymbol) * es->es_cap);
+        es->es_symbols = symbols_rea;
+    }
+
+    struct elfsymbol *s = &es->es_symbols[es->es_len++];
+    s->es_low = value;
+    s->es_high = value + size;
+    s->es_size = size;
+    s->es_global = (info >> 4) == STB_GLOBAL;
+    s->es_name = (const char *)str + name;
+}
+
+/* Add the function symbols from one symbol table and its string
+ * table. pointersize is 4 or 8, the class of the file they came from.
+ */
+void elfsym_add_symbols(struct elfsym *es, const unsigned char *syms,
+        uint64_t symsize, const unsigned char *str, uint64_t strsize,
+        int pointersize){
+    if(pointersize == 8){
+        for(uint64_t off=0; off+sizeof(struct elf64_sym)<=symsize;
+                off+=sizeof(struct elf64_sym)){
+            struct elf64_sym sym;
+            memcpy(&sym, syms + off, sizeof(sym));
+
+            add_symbol(es, str, strsize, sym.st_name, sym.st_info,
+                    sym.st_shndx, sym.st_value, sym.st_size);
+        }
+    }
+    else{
+        for(uint64_t off=0; off+sizeof(struct elf32_sym)<=symsize;
+                off+=sizeof(struct elf32_sym)){
+            struct elf32_sym sym;
+            memcpy(&sym, syms + off, sizeof(sym));
+
+            add_symbol(es, str, strsize, sym.st_name, sym.st_info,
+                    sym.st_shndx, sym.st_value, sym.st_size);
+        }
+    }
+}
+
+/* By address, then the one we'd rather report first: sized before
+ * sizeless, global before local.
+ */
+static int elfsymbol_cmp(const void *a, const void *b){
+    const struct elfsymbol *sa = a, *sb = b;
+
+    if(sa->es_low != sb->es_low)
+        return sa->es_low < sb->es_low ? -1 : 1;
+
+    if((sa->es_size != 0) != (sb->es_size != 0))
+        return sa->es_size ? -1 : 1;
+
+    if(sa->es_global != sb->es_global)
+        return sa->es_global ? -1 : 1;
+
+    return 0;
+}
+
+/* Sort, keep one symbol per address, since .symtab and .dynsym repeat
+ * each other and aliases share an address, and give sizeless symbols
+ * everything up to the next one. Must be called before elfsym_find.
+ */
+void elfsym_finish(struct elfsym *es){
+    if(es->es_len == 0)
+        return;
+
+    qsort(es->es_symbols, es->es_len, sizeof(struct elfsymbol),
+            elfsymbol_cmp);
+
+    int len = 1;
+
+    for(int i=1; i<es->es_len; i++){
+        if(es->es_symbols[i].es_low != es->es_symbols[len - 1].es_low)
+            es->es_symbols[len++] = es->es_symbols[i];
+    }
+
+    es->es_len = len;
+
+    for(int i=0; i<es->es_len - 1; i++){
+        struct elfsymbol *s = &es->es_symbols[i];
+
+        if(s->es_size == 0)
+            s->es_high = es->es_symbols[i + 1].es_low;
+    }
+
+    /* Nothing bounds the last one, only its first byte is its own */
+    struct elfsymbol *last = &es->es_symbols[es->es_len - 1];
+
+    if(last->es_size == 0)
+        last->es_high = last->es_low + 1;
+}
+
+/* Find the function symbol containing pc, and how far into it pc is.
+ * Returns 1 if there isn't one.
+ */
+int elfsym_find(struct elfsym *es, uint64_t pc, const char **nameout,
+        uint64_t *offsetout){
+    int lo = 0, hi = es->es_len - 1, found = -1;
+
+    while(lo <= hi){
+        int mid = lo + ((hi - lo) / 2);
+
+        if(es->es_symbols[mid].es_low <= pc){
+            found = mid;
+            lo = mid + 1;
+        }
+        else{
+            hi = mid - 1;
+        }
+    }
+
+    if(found == -1 || pc >= es->es_symbols[found].es_high)
+        return 1;
+
+    *nameout = es->es_symbols[found].es_name;
+    *offsetout = pc - es->es_symbols[found].es_low;
+
+    return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef _ELFSYM_H_
+#define _ELFSYM_H_
+
+#include <stdint.h>
+
+struct elfsym;
+
+void elfsym_add_symbols(struct elfsym *, const unsigned char *, uint64_t,
+        const unsigned char *, uint64_t, int);
+int elfsym_find(struct elfsym *, uint64_t, const char **, uint64_t *);
+void elfsym_finish(struct elfsym *);
+void elfsym_free(struct elfsym *);
+struct elfsym *elfsym_new(void);
+
+#endif
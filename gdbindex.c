@@ -0,0 +1,270 @@
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dwarf.h>
+
+#include "gdbindex.h"
+
+/* The .gdb_index section that gold and lld write with --gdb-index:
+ *
+ *      header              version, then the offset of each area
+ *      compilation units   { uint64_t offset, length }[]
+ *      type units          { uint64_t offset, type offset, sig }[]
+ *      address area        { uint64_t low, high; uint32_t cu }[]
+ *      symbol table        { uint32_t name, cu vector }[], power of 2
+ *      shortcut table      version 9 only, we don't use it
+ *      constant pool       names, and the CU vectors they point to
+ *
+ * A CU vector is a count followed by that many words, each holding a
+ * compilation unit index and what kind of symbol the name is there.
+ * Everything is little endian no matter what the file is.
+ */
+
+#define GDBINDEX_MIN_VERSION (7)
+#define GDBINDEX_MAX_VERSION (9)
+
+#define GDBINDEX_ADDR_ENTRY_SIZE (20)
+
+#define GDBINDEX_CU_MASK (0xffffff)
+#define GDBINDEX_KIND_SHIFT (28)
+#define GDBINDEX_KIND_MASK (7)
+
+enum {
+    GDBINDEX_KIND_TYPE = 1,
+    GDBINDEX_KIND_VARIABLE,
+    GDBINDEX_KIND_FUNCTION
+};
+
+struct gdbindex {
+    const unsigned char *gi_data;
+    uint64_t gi_size;
+
+    uint32_t gi_version;
+
+    const unsigned char *gi_cus;
+    uint32_t gi_numcus;
+
+    const unsigned char *gi_addrs;
+    uint32_t gi_numaddrs;
+
+    const unsigned char *gi_symtab;
+    uint32_t gi_symtabslots;
+
+    uint64_t gi_constpooloff;
+};
+
+static uint32_t read_le32(const unsigned char *p){
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+        ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t read_le64(const unsigned char *p){
+    return (uint64_t)read_le32(p) | ((uint64_t)read_le32(p + 4) << 32);
+}
+
+/* Returns NULL if the section isn't a version we understand. Nothing
+ * is copied, the section has to outlive the returned index.
+ */
+struct gdbindex *gdbindex_new(const unsigned char *data, uint64_t size){
+    if(!data || size < 24)
+        return NULL;
+
+    uint32_t version = read_le32(data);
+
+    if(version < GDBINDEX_MIN_VERSION || version > GDBINDEX_MAX_VERSION)
+        return NULL;
+
+    uint64_t cusoff = read_le32(data + 4);
+    uint64_t tusoff = read_le32(data + 8);
+    uint64_t addrsoff = read_le32(data + 12);
+    uint64_t symtaboff = read_le32(data + 16);
+    uint64_t symtabend = read_le32(data + 20);
+
+    /* Version 9 puts the shortcut table between the symbol table and
+     * the constant pool.
+     */
+    uint64_t constpooloff = symtabend;
+
+    if(version >= 9){
+        if(size < 28)
+            return NULL;
+
+        constpooloff = read_le32(data + 24);
+    }
+
+    if(cusoff > tusoff || tusoff > addrsoff || addrsoff > symtaboff ||
+            symtaboff > symtabend || symtabend > constpooloff ||
+            constpooloff > size){
+        return NULL;
+    }
+
+    uint64_t symtabslots = (symtabend - symtaboff) / 8;
+
+    /* Probing relies on the table being a power of two */
+    if(symtabslots & (symtabslots - 1))
+        return NULL;
+
+    struct gdbindex *gi = calloc(1, sizeof(struct gdbindex));
+    gi->gi_data = data;
+    gi->gi_size = size;
+    gi->gi_version = version;
+    gi->gi_cus = data + cusoff;
+    gi->gi_numcus = (tusoff - cusoff) / 16;
+    gi->gi_addrs = data + addrsoff;
+    gi->gi_numaddrs = (symtaboff - addrsoff) / GDBINDEX_ADDR_ENTRY_SIZE;
+    gi->gi_symtab = data + symtaboff;
+    gi->gi_symtabslots = symtabslots;
+    gi->gi_constpooloff = constpooloff;
+
+    return gi;
+}
+
+void gdbindex_free(struct gdbindex *gi){
+    free(gi);
+}
+
+uint32_t gdbindex_get_numcus(struct gdbindex *gi){
+    return gi->gi_numcus;
+}
+
+/* .debug_info offset and length of compilation unit idx, the length
+ * includes the unit's initial length field.
+ */
+void gdbindex_get_cu(struct gdbindex *gi, uint32_t idx, uint64_t *offout,
+        uint64_t *lenout){
+    *offout = read_le64(gi->gi_cus + ((uint64_t)idx * 16));
+    *lenout = read_le64(gi->gi_cus + ((uint64_t)idx * 16) + 8);
+}
+
+uint32_t gdbindex_get_numaddrs(struct gdbindex *gi){
+    return gi->gi_numaddrs;
+}
+
+void gdbindex_get_addr(struct gdbindex *gi, uint32_t idx, uint64_t *lowout,
+        uint64_t *highout, uint32_t *cuidxout){
+    const unsigned char *entry =
+        gi->gi_addrs + ((uint64_t)idx * GDBINDEX_ADDR_ENTRY_SIZE);
+
+    *lowout = read_le64(entry);
+    *highout = read_le64(entry + 8);
+    *cuidxout = read_le32(entry + 16);
+}
+
+/* gdb's mapped_index_string_hash, case insensitive since version 5 */
+static uint32_t gdbindex_hash(const char *name){
+    uint32_t hash = 0;
+
+    for(const unsigned char *p=(const unsigned char *)name; *p; p++)
+        hash = (hash * 67) + (uint32_t)tolower(*p) - 113;
+
+    return hash;
+}
+
+static int kind_matches(uint32_t kind, int tag){
+    switch(tag){
+        case 0:
+            return 1;
+        case DW_TAG_subprogram:
+            return kind == GDBINDEX_KIND_FUNCTION;
+        case DW_TAG_variable:
+            return kind == GDBINDEX_KIND_VARIABLE;
+        default:
+            return kind == GDBINDEX_KIND_TYPE;
+    }
+}
+
+static int name_matches(struct gdbindex *gi, uint64_t nameoff,
+        const char *name){
+    uint64_t off = gi->gi_constpooloff + nameoff;
+
+    if(off >= gi->gi_size)
+        return 0;
+
+    const char *str = (const char *)gi->gi_data + off;
+    size_t maxlen = gi->gi_size - off;
+    size_t namelen = strlen(name);
+
+    return namelen < maxlen && memcmp(str, name, namelen + 1) == 0;
+}
+
+static void add_cuidx(uint32_t **cuidxs, int *len, int *cap, uint32_t cuidx){
+    for(int i=0; i<*len; i++){
+        if((*cuidxs)[i] == cuidx)
+            return;
+    }
+
+    if(*len == *cap){
+        *cap = *cap ? *cap * 2 : 8;
+
+        uint32_t *cuidxs_rea = realloc(*cuidxs, sizeof(uint32_t) * *cap);
+        *cuidxs = cuidxs_rea;
+    }
+
+    (*cuidxs)[(*len)++] = cuidx;
+}
+
+/* Find the index of every compilation unit that has a symbol named
+ * name of the kind tag is, any kind if tag is 0. Type units are left
+ * out. The array must be freed. Returns 1 if there aren't any.
+ */
+int gdbindex_find(struct gdbindex *gi, const char *name, int tag,
+        uint32_t **cuidxsout, int *lenout){
+    if(gi->gi_symtabslots == 0)
+        return 1;
+
+    uint32_t hash = gdbindex_hash(name);
+    uint32_t mask = gi->gi_symtabslots - 1;
+    uint32_t slot = hash & mask;
+    uint32_t step = ((hash * 17) & mask) | 1;
+
+    for(uint32_t probes=0; probes<gi->gi_symtabslots; probes++){
+        const unsigned char *entry = gi->gi_symtab + ((uint64_t)slot * 8);
+        uint32_t nameoff = read_le32(entry);
+        uint32_t vecoff = read_le32(entry + 4);
+
+        /* An empty slot ends the probe sequence */
+        if(nameoff == 0 && vecoff == 0)
+            return 1;
+
+        if(name_matches(gi, nameoff, name)){
+            uint64_t off = gi->gi_constpooloff + vecoff;
+
+            if(off > gi->gi_size - 4)
+                return 1;
+
+            uint32_t count = read_le32(gi->gi_data + off);
+
+            if(count > (gi->gi_size - off - 4) / 4)
+                return 1;
+
+            uint32_t *cuidxs = NULL;
+            int len = 0, cap = 0;
+
+            for(uint32_t i=0; i<count; i++){
+                uint32_t word = read_le32(gi->gi_data + off + 4 + (i * 4));
+                uint32_t cuidx = word & GDBINDEX_CU_MASK;
+                uint32_t kind = (word >> GDBINDEX_KIND_SHIFT) &
+                    GDBINDEX_KIND_MASK;
+
+                if(cuidx < gi->gi_numcus && kind_matches(kind, tag))
+                    add_cuidx(&cuidxs, &len, &cap, cuidx);
+            }
+
+            if(len == 0){
+                free(cuidxs);
+                return 1;
+            }
+
+            *cuidxsout = cuidxs;
+            *lenout = len;
+
+            return 0;
+        }
+
+        slot = (slot + step) & mask;
+    }
+
+    return 1;
+}
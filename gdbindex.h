@@ -0,0 +1,17 @@
+#ifndef _GDBINDEX_H_
+#define _GDBINDEX_H_
+
+#include <stdint.h>
+
+struct gdbindex;
+
+int gdbindex_find(struct gdbindex *, const char *, int, uint32_t **, int *);
+void gdbindex_free(struct gdbindex *);
+void gdbindex_get_addr(struct gdbindex *, uint32_t, uint64_t *, uint64_t *,
+        uint32_t *);
+void gdbindex_get_cu(struct gdbindex *, uint32_t, uint64_t *, uint64_t *);
+uint32_t gdbindex_get_numaddrs(struct gdbindex *);
+uint32_t gdbindex_get_numcus(struct gdbindex *);
+struct gdbindex *gdbindex_new(const unsigned char *, uint64_t);
+
+#endif
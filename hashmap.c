@@ -0,0 +1,107 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "hashmap.h"
+
+#define HASHMAP_INITIAL_CAPACITY 64
+
+/* Keys like DIE offsets are far from random, so mix them up before
+ * they pick a slot.
+ */
+static uint64_t mix(uint64_t key){
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+
+    return key;
+}
+
+static struct hashmap_entry *find_slot(struct hashmap_entry *entries,
+        uint64_t capacity, uint64_t key){
+    uint64_t idx = mix(key) & (capacity - 1);
+
+    while(entries[idx].used && entries[idx].key != key)
+        idx = (idx + 1) & (capacity - 1);
+
+    return &entries[idx];
+}
+
+static void grow(struct hashmap *map){
+    uint64_t newcap = map->capacity * 2;
+    struct hashmap_entry *newentries = calloc(newcap,
+            sizeof(struct hashmap_entry));
+
+    for(uint64_t i=0; i<map->capacity; i++){
+        struct hashmap_entry *old = &map->entries[i];
+
+        if(!old->used)
+            continue;
+
+        *find_slot(newentries, newcap, old->key) = *old;
+    }
+
+    free(map->entries);
+
+    map->entries = newentries;
+    map->capacity = newcap;
+}
+
+struct hashmap *hashmap_new(void){
+    struct hashmap *map = malloc(sizeof(struct hashmap));
+
+    map->capacity = HASHMAP_INITIAL_CAPACITY;
+    map->count = 0;
+    map->entries = calloc(map->capacity, sizeof(struct hashmap_entry));
+
+    return map;
+}
+
+void *hashmap_get(struct hashmap *map, uint64_t key){
+    if(!map)
+        return NULL;
+
+    struct hashmap_entry *entry = find_slot(map->entries, map->capacity, key);
+
+    if(!entry->used)
+        return NULL;
+
+    return entry->value;
+}
+
+void hashmap_set(struct hashmap *map, uint64_t key, void *value){
+    /* Keep the load factor under 3/4 */
+    if((map->count + 1) * 4 > map->capacity * 3)
+        grow(map);
+
+    struct hashmap_entry *entry = find_slot(map->entries, map->capacity, key);
+
+    if(!entry->used){
+        entry->used = 1;
+        entry->key = key;
+        map->count++;
+    }
+
+    entry->value = value;
+}
+
+void hashmap_free(struct hashmap *map){
+    if(!map)
+        return;
+
+    free(map->entries);
+    free(map);
+}
+
+/* 64 bit FNV-1a */
+uint64_t hash_string(const char *str){
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    while(*str){
+        hash ^= (unsigned char)*str++;
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
@@ -0,0 +1,26 @@
+#ifndef _HASHMAP_H_
+#define _HASHMAP_H_
+
+#include <stdint.h>
+
+struct hashmap_entry {
+    uint64_t key;
+    void *value;
+    int used;
+};
+
+/* Open addressing hash map from 64 bit keys to pointers */
+struct hashmap {
+    struct hashmap_entry *entries;
+    uint64_t capacity;
+    uint64_t count;
+};
+
+struct hashmap *hashmap_new(void);
+void *hashmap_get(struct hashmap *, uint64_t);
+void hashmap_set(struct hashmap *, uint64_t, void *);
+void hashmap_free(struct hashmap *);
+
+uint64_t hash_string(const char *);
+
+#endif
@@ -0,0 +1,564 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libdwarf.h>
+
+#include "strtab.h"
+
+enum {
+    LT_IS_STMT =            (1 << 0),
+    LT_BASIC_BLOCK =        (1 << 1),
+    LT_END_SEQUENCE =       (1 << 2)
+};
+
+/* A compilation unit's line program, decoded once and sorted by
+ * address. Row i is lt_addrs[i], lt_lines[i], lt_files[i], lt_flags[i].
+ * Rows with the same address keep their line program order, except
+ * end of sequence rows, which go after everything else at that address.
+ */
+struct linetable {
+    uint64_t *lt_addrs;
+    uint32_t *lt_lines;
+    uint32_t *lt_files;
+    uint8_t *lt_flags;
+    int lt_len;
+
+    /* Interned source file names, lt_files indexes into this */
+    const char **lt_filenames;
+    int lt_numfiles;
+
+    /* Row indexes sorted by (file, line, address), for going from a
+     * line to its PCs. Rows from file f are
+     * lt_byline[lt_filestart[f]] to lt_byline[lt_filestart[f + 1] - 1].
+     * End of sequence rows and rows for line 0 aren't included.
+     */
+    int *lt_byline;
+    int *lt_filestart;
+    int lt_bylinelen;
+};
+
+/* Used only while decoding, before the table is split up */
+struct linerow {
+    uint64_t lr_addr;
+    uint32_t lr_line;
+    uint32_t lr_file;
+    uint8_t lr_flags;
+    int lr_order;
+};
+
+static int linerow_cmp(const void *a, const void *b){
+    const struct linerow *ra = a, *rb = b;
+
+    if(ra->lr_addr != rb->lr_addr)
+        return ra->lr_addr < rb->lr_addr ? -1 : 1;
+
+    int ra_end = ra->lr_flags & LT_END_SEQUENCE;
+    int rb_end = rb->lr_flags & LT_END_SEQUENCE;
+
+    if(ra_end != rb_end)
+        return ra_end ? 1 : -1;
+
+    return ra->lr_order - rb->lr_order;
+}
+
+/* Only valid while build_line_index is sorting */
+static _Thread_local struct linetable *SORTING;
+
+static int byline_cmp(const void *a, const void *b){
+    int ra = *(const int *)a, rb = *(const int *)b;
+    struct linetable *lt = SORTING;
+
+    if(lt->lt_files[ra] != lt->lt_files[rb])
+        return lt->lt_files[ra] < lt->lt_files[rb] ? -1 : 1;
+
+    if(lt->lt_lines[ra] != lt->lt_lines[rb])
+        return lt->lt_lines[ra] < lt->lt_lines[rb] ? -1 : 1;
+
+    if(lt->lt_addrs[ra] != lt->lt_addrs[rb])
+        return lt->lt_addrs[ra] < lt->lt_addrs[rb] ? -1 : 1;
+
+    return ra - rb;
+}
+
+static void build_line_index(struct linetable *lt){
+    lt->lt_byline = malloc(sizeof(int) * (lt->lt_len + 1));
+    lt->lt_filestart = calloc(lt->lt_numfiles + 1, sizeof(int));
+    lt->lt_bylinelen = 0;
+
+    for(int i=0; i<lt->lt_len; i++){
+        if(lt->lt_lines[i] == 0 || (lt->lt_flags[i] & LT_END_SEQUENCE))
+            continue;
+
+        lt->lt_byline[lt->lt_bylinelen++] = i;
+    }
+
+    SORTING = lt;
+    qsort(lt->lt_byline, lt->lt_bylinelen, sizeof(int), byline_cmp);
+    SORTING = NULL;
+
+    /* Partition by file so a (file, line) lookup only has to
+     * search that file's rows.
+     */
+    int file = 0;
+
+    for(int i=0; i<lt->lt_bylinelen; i++){
+        uint32_t rowfile = lt->lt_files[lt->lt_byline[i]];
+
+        while(file <= (int)rowfile)
+            lt->lt_filestart[file++] = i;
+    }
+
+    while(file <= lt->lt_numfiles)
+        lt->lt_filestart[file++] = lt->lt_bylinelen;
+}
+
+static uint32_t get_file_index(struct linetable *lt, void *strtab,
+        const char *filename, uint32_t lastidx){
+    const char *interned = strtab_intern(strtab, filename);
+
+    /* Consecutive rows are almost always from the same file */
+    if(lt->lt_numfiles > 0 && lt->lt_filenames[lastidx] == interned)
+        return lastidx;
+
+    for(int i=0; i<lt->lt_numfiles; i++){
+        if(lt->lt_filenames[i] == interned)
+            return i;
+    }
+
+    const char **filenames_rea = realloc(lt->lt_filenames,
+            sizeof(char *) * (lt->lt_numfiles + 1));
+    lt->lt_filenames = filenames_rea;
+    lt->lt_filenames[lt->lt_numfiles] = interned;
+
+    return lt->lt_numfiles++;
+}
+
+static int get_flag(Dwarf_Debug dbg, Dwarf_Line line,
+        int (*fxn)(Dwarf_Line, Dwarf_Bool *, Dwarf_Error *)){
+    Dwarf_Bool flag = 0;
+    Dwarf_Error d_error = NULL;
+
+    int ret = fxn(line, &flag, &d_error);
+
+    if(ret == DW_DLV_ERROR){
+        dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+        return 0;
+    }
+
+    return flag;
+}
+
+int linetable_new(Dwarf_Debug dbg, void *strtab, Dwarf_Line *lines,
+        Dwarf_Signed cnt, struct linetable **out){
+    struct linetable *lt = calloc(1, sizeof(struct linetable));
+    struct linerow *rows = malloc(sizeof(struct linerow) * (cnt + 1));
+    uint32_t lastfile = 0;
+
+    for(Dwarf_Signed i=0; i<cnt; i++){
+        Dwarf_Line line = lines[i];
+        Dwarf_Error d_error = NULL;
+        struct linerow *row = &rows[i];
+
+        memset(row, 0, sizeof(struct linerow));
+        row->lr_order = (int)i;
+
+        Dwarf_Addr addr = 0;
+        if(dwarf_lineaddr(line, &addr, &d_error) == DW_DLV_ERROR){
+            dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+            d_error = NULL;
+        }
+
+        row->lr_addr = addr;
+
+        Dwarf_Unsigned lineno = 0;
+        if(dwarf_lineno(line, &lineno, &d_error) == DW_DLV_ERROR){
+            dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+            d_error = NULL;
+        }
+
+        row->lr_line = (uint32_t)lineno;
+
+        char *filename = NULL;
+        int ret = dwarf_linesrc(line, &filename, &d_error);
+
+        if(ret == DW_DLV_ERROR){
+            dwarf_dealloc(dbg, d_error, DW_DLA_ERROR);
+            d_error = NULL;
+        }
+
+        if(ret == DW_DLV_OK){
+            lastfile = get_file_index(lt, strtab, filename, lastfile);
+            dwarf_dealloc(dbg, filename, DW_DLA_STRING);
+        }
+        else{
+            lastfile = get_file_index(lt, strtab, "", lastfile);
+        }
+
+        row->lr_file = lastfile;
+
+        if(get_flag(dbg, line, dwarf_linebeginstatement))
+            row->lr_flags |= LT_IS_STMT;
+
+        if(get_flag(dbg, line, dwarf_lineblock))
+            row->lr_flags |= LT_BASIC_BLOCK;
+
+        if(get_flag(dbg, line, dwarf_lineendsequence))
+            row->lr_flags |= LT_END_SEQUENCE;
+    }
+
+    qsort(rows, cnt, sizeof(struct linerow), linerow_cmp);
+
+    lt->lt_len = (int)cnt;
+    lt->lt_addrs = malloc(sizeof(uint64_t) * (cnt + 1));
+    lt->lt_lines = malloc(sizeof(uint32_t) * (cnt + 1));
+    lt->lt_files = malloc(sizeof(uint32_t) * (cnt + 1));
+    lt->lt_flags = malloc(sizeof(uint8_t) * (cnt + 1));
+
+    for(Dwarf_Signed i=0; i<cnt; i++){
+        lt->lt_addrs[i] = rows[i].lr_addr;
+        lt->lt_lines[i] = rows[i].lr_line;
+        lt->lt_files[i] = rows[i].lr_file;
+        lt->lt_flags[i] = rows[i].lr_flags;
+    }
+
+    free(rows);
+
+    build_line_index(lt);
+
+    *out = lt;
+
+    return 0;
+}
+
+void linetable_free(struct linetable *lt){
+    if(!lt)
+        return;
+
+    free(lt->lt_filenames);
+    free(lt->lt_addrs);
+    free(lt->lt_lines);
+    free(lt->lt_files);
+    free(lt->lt_flags);
+    free(lt->lt_byline);
+    free(lt->lt_filestart);
+    free(lt);
+}
+
+/* Index of the first row whose address is greater than pc */
+static int upper_bound(struct linetable *lt, uint64_t pc){
+    int lo = 0, hi = lt->lt_len;
+
+    while(lo < hi){
+        int mid = lo + ((hi - lo) / 2);
+
+        if(lt->lt_addrs[mid] <= pc)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* upper_bound, knowing the answer is at least start. Gallops ahead
+ * from start first, so a run of nearby PCs only looks at nearby rows.
+ */
+static int upper_bound_from(struct linetable *lt, uint64_t pc, int start){
+    int lo = start, step = 1;
+
+    while(lo + step < lt->lt_len && lt->lt_addrs[lo + step] <= pc){
+        lo += step;
+        step *= 2;
+    }
+
+    int hi = lo + step < lt->lt_len ? lo + step : lt->lt_len;
+
+    while(lo < hi){
+        int mid = lo + ((hi - lo) / 2);
+
+        if(lt->lt_addrs[mid] <= pc)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* Index of the first row for the instruction containing pc, -1 if pc
+ * isn't covered by this line table.
+ */
+int linetable_find_row_containing(struct linetable *lt, uint64_t pc){
+    if(!lt)
+        return -1;
+
+    int row = upper_bound(lt, pc) - 1;
+
+    if(row < 0)
+        return -1;
+
+    uint64_t addr = lt->lt_addrs[row];
+
+    while(row > 0 && lt->lt_addrs[row - 1] == addr)
+        row--;
+
+    if(lt->lt_flags[row] & LT_END_SEQUENCE)
+        return -1;
+
+    return row;
+}
+
+/* linetable_find_row_containing for every one of pcs, which must be in
+ * ascending order, in one pass over the table.
+ */
+void linetable_find_rows_containing(struct linetable *lt,
+        const uint64_t *pcs, int n, int *rowsout){
+    int pos = 0;
+
+    for(int i=0; i<n; i++){
+        if(!lt){
+            rowsout[i] = -1;
+            continue;
+        }
+
+        pos = upper_bound_from(lt, pcs[i], pos);
+
+        int row = pos - 1;
+
+        if(row < 0){
+            rowsout[i] = -1;
+            continue;
+        }
+
+        uint64_t addr = lt->lt_addrs[row];
+
+        while(row > 0 && lt->lt_addrs[row - 1] == addr)
+            row--;
+
+        rowsout[i] = (lt->lt_flags[row] & LT_END_SEQUENCE) ? -1 : row;
+    }
+}
+
+/* Index of the first row whose address is pc, -1 if there isn't one.
+ * End of sequence rows don't describe an instruction, so they never
+ * match.
+ */
+int linetable_find_row_exact(struct linetable *lt, uint64_t pc){
+    int row = linetable_find_row_containing(lt, pc);
+
+    if(row == -1 || lt->lt_addrs[row] != pc)
+        return -1;
+
+    return row;
+}
+
+/* Index of the first row after pc that starts a different, non-zero
+ * source line, -1 if there isn't one.
+ */
+int linetable_find_next_line_row(struct linetable *lt, uint64_t pc,
+        uint64_t curlineno){
+    if(!lt)
+        return -1;
+
+    for(int i=upper_bound(lt, pc); i<lt->lt_len; i++){
+        if(lt->lt_flags[i] & LT_END_SEQUENCE)
+            continue;
+
+        if(lt->lt_lines[i] != 0 && lt->lt_lines[i] != curlineno)
+            return i;
+    }
+
+    return -1;
+}
+
+/* Position of the first row from file whose line is at least line,
+ * within the file's partition of lt_byline.
+ */
+static int line_lower_bound(struct linetable *lt, int file, uint64_t line){
+    int lo = lt->lt_filestart[file], hi = lt->lt_filestart[file + 1];
+
+    while(lo < hi){
+        int mid = lo + ((hi - lo) / 2);
+
+        if(lt->lt_lines[lt->lt_byline[mid]] < line)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static int pc_cmp(const void *a, const void *b){
+    uint64_t pa = *(const uint64_t *)a, pb = *(const uint64_t *)b;
+
+    if(pa == pb)
+        return 0;
+
+    return pa < pb ? -1 : 1;
+}
+
+/* Whether a line table file name is the file someone asked for. They
+ * might give a full path, or only the end of one, like "foo.c" or
+ * "src/foo.c".
+ */
+static int file_matches(const char *path, const char *name){
+    size_t pathlen = strlen(path), namelen = strlen(name);
+
+    if(pathlen < namelen)
+        return 0;
+
+    if(strcmp(path + pathlen - namelen, name) != 0)
+        return 0;
+
+    return pathlen == namelen || name[0] == '/' ||
+        path[pathlen - namelen - 1] == '/';
+}
+
+/* Every PC line starts at in file, or across all files if file is
+ * NULL, sorted and without duplicates. Only the partitions of files
+ * that match are searched. *pcs is always allocated so the caller can
+ * free it.
+ */
+void linetable_get_pcs_for_file_line(struct linetable *lt, const char *file,
+        uint64_t line, uint64_t **pcs, int *len){
+    *len = 0;
+
+    if(!lt){
+        *pcs = calloc(1, sizeof(uint64_t));
+        return;
+    }
+
+    int total = 0;
+
+    for(int f=0; f<lt->lt_numfiles; f++){
+        if(file && !file_matches(lt->lt_filenames[f], file))
+            continue;
+
+        int start = line_lower_bound(lt, f, line);
+        int end = line_lower_bound(lt, f, line + 1);
+
+        total += end - start;
+    }
+
+    *pcs = calloc(total + 1, sizeof(uint64_t));
+
+    for(int f=0; f<lt->lt_numfiles; f++){
+        if(file && !file_matches(lt->lt_filenames[f], file))
+            continue;
+
+        int start = line_lower_bound(lt, f, line);
+        int end = line_lower_bound(lt, f, line + 1);
+
+        for(int i=start; i<end; i++)
+            (*pcs)[(*len)++] = lt->lt_addrs[lt->lt_byline[i]];
+    }
+
+    /* Each file's rows are already in address order, so this only
+     * matters when the line shows up in more than one file.
+     */
+    qsort(*pcs, *len, sizeof(uint64_t), pc_cmp);
+
+    int unique = 0;
+
+    for(int i=0; i<*len; i++){
+        if(unique == 0 || (*pcs)[unique - 1] != (*pcs)[i])
+            (*pcs)[unique++] = (*pcs)[i];
+    }
+
+    *len = unique;
+}
+
+void linetable_get_pcs_for_line(struct linetable *lt, uint64_t line,
+        uint64_t **pcs, int *len){
+    linetable_get_pcs_for_file_line(lt, NULL, line, pcs, len);
+}
+
+/* Find the line closest to line that has code. When a line before and
+ * a line after are equally close, the one after wins, since that's
+ * where execution goes next. If more than one file has the winning
+ * line, the lowest address is used. Returns 1 if this line table
+ * has no lines at all.
+ */
+int linetable_find_nearest_line(struct linetable *lt, uint64_t line,
+        uint64_t *nearestline, uint64_t *addr){
+    if(!lt)
+        return 1;
+
+    int found = 0;
+    uint64_t bestdist = 0, bestline = 0, bestaddr = 0;
+
+    for(int f=0; f<lt->lt_numfiles; f++){
+        int pos = line_lower_bound(lt, f, line);
+        int candidates[2] = { -1, -1 };
+
+        /* First line at or after the one we want */
+        if(pos < lt->lt_filestart[f + 1])
+            candidates[0] = pos;
+
+        /* Last line before it. Rows for a line are in address order,
+         * so step back to the first row for that line.
+         */
+        if(pos > lt->lt_filestart[f]){
+            int before = pos - 1;
+            uint32_t beforeline = lt->lt_lines[lt->lt_byline[before]];
+
+            while(before > lt->lt_filestart[f] &&
+                    lt->lt_lines[lt->lt_byline[before - 1]] == beforeline){
+                before--;
+            }
+
+            candidates[1] = before;
+        }
+
+        for(int c=0; c<2; c++){
+            if(candidates[c] == -1)
+                continue;
+
+            int row = lt->lt_byline[candidates[c]];
+            uint64_t curline = lt->lt_lines[row];
+            uint64_t curaddr = lt->lt_addrs[row];
+            uint64_t dist = curline >= line ? curline - line : line - curline;
+
+            int better = !found || dist < bestdist ||
+                (dist == bestdist && curline > bestline) ||
+                (dist == bestdist && curline == bestline &&
+                 curaddr < bestaddr);
+
+            if(better){
+                found = 1;
+                bestdist = dist;
+                bestline = curline;
+                bestaddr = curaddr;
+            }
+        }
+    }
+
+    if(!found)
+        return 1;
+
+    *nearestline = bestline;
+    *addr = bestaddr;
+
+    return 0;
+}
+
+int linetable_get_num_rows(struct linetable *lt){
+    if(!lt)
+        return 0;
+
+    return lt->lt_len;
+}
+
+void linetable_get_row(struct linetable *lt, int row, uint64_t *addr,
+        uint64_t *lineno, const char **filename){
+    if(addr)
+        *addr = lt->lt_addrs[row];
+
+    if(lineno)
+        *lineno = lt->lt_lines[row];
+
+    if(filename)
+        *filename = lt->lt_filenames[lt->lt_files[row]];
+}
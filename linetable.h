@@ -0,0 +1,17 @@
+#ifndef _LINETABLE_H_
+#define _LINETABLE_H_
+
+int linetable_find_nearest_line(void *, uint64_t, uint64_t *, uint64_t *);
+int linetable_find_next_line_row(void *, uint64_t, uint64_t);
+int linetable_find_row_containing(void *, uint64_t);
+int linetable_find_row_exact(void *, uint64_t);
+void linetable_find_rows_containing(void *, const uint64_t *, int, int *);
+void linetable_free(void *);
+int linetable_get_num_rows(void *);
+void linetable_get_pcs_for_file_line(void *, const char *, uint64_t,
+        uint64_t **, int *);
+void linetable_get_pcs_for_line(void *, uint64_t, uint64_t **, int *);
+void linetable_get_row(void *, int, uint64_t *, uint64_t *, const char **);
+int linetable_new(Dwarf_Debug, void *, Dwarf_Line *, Dwarf_Signed, void **);
+
+#endif
@@ -0,0 +1,167 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "hashmap.h"
+
+/* Every named DIE of every compilation unit whose DIE tree has been
+ * built, keyed by name. Names are interned in the string pool, so
+ * two names are equal only if their pointers are, and the pointer
+ * itself is the key.
+ */
+struct nameentry {
+    const char *ne_name;
+    void *ne_die;
+    void *ne_cu;
+    int ne_tag;
+    struct nameentry *ne_next;
+};
+
+/* Every DIE with the same name shares one of these. Entries are kept in the order they were added, so for any one
+ * compilation unit they're in DIE tree order.
+ */
+struct namechain {
+    struct nameentry *nc_first;
+    struct nameentry *nc_last;
+};
+
+struct nameindex {
+    struct hashmap *ni_chains;
+};
+
+struct nameindex *nameindex_new(void){
+    struct nameindex *index = malloc(sizeof(struct nameindex));
+    index->ni_chains = hashmap_new();
+
+    return index;
+}
+
+void nameindex_add(struct nameindex *index, const char *name, void *die,
+        void *cu, int tag){
+    if(!name)
+        return;
+
+    uint64_t key = (uintptr_t)name;
+    struct namechain *chain = hashmap_get(index->ni_chains, key);
+
+    if(!chain){
+        chain = calloc(1, sizeof(struct namechain));
+        hashmap_set(index->ni_chains, key, chain);
+    }
+
+    struct nameentry *entry = malloc(sizeof(struct nameentry));
+    entry->ne_name = name;
+    entry->ne_die = die;
+    entry->ne_cu = cu;
+    entry->ne_tag = tag;
+    entry->ne_next = NULL;
+
+    if(chain->nc_last)
+        chain->nc_last->ne_next = entry;
+    else
+        chain->nc_first = entry;
+
+    chain->nc_last = entry;
+}
+
+static struct nameentry *first_entry(struct nameindex *index,
+        const char *name){
+    struct namechain *chain = hashmap_get(index->ni_chains,
+            (uintptr_t)name);
+
+    if(!chain)
+        return NULL;
+
+    return chain->nc_first;
+}
+
+static int entry_matches(struct nameentry *e, int tag){
+    return tag == 0 || e->ne_tag == tag;
+}
+
+/* name must come from the string pool. Returns 1 if nothing is
+ * named name. A tag of 0 matches any DIE.
+ * On success, *dies and *cus are parallel arrays which the caller frees.
+ */
+int nameindex_find(struct nameindex *index, const char *name, int tag,
+        void ***dies, void ***cus, int *len){
+    int count = 0;
+
+    for(struct nameentry *e = first_entry(index, name); e; e = e->ne_next){
+        if(entry_matches(e, tag))
+            count++;
+    }
+
+    *len = 0;
+
+    if(count == 0)
+        return 1;
+
+    *dies = malloc(sizeof(void *) * count);
+    *cus = malloc(sizeof(void *) * count);
+
+    for(struct nameentry *e = first_entry(index, name); e; e = e->ne_next){
+        if(!entry_matches(e, tag))
+            continue;
+
+        (*dies)[*len] = e->ne_die;
+        (*cus)[*len] = e->ne_cu;
+        (*len)++;
+    }
+
+    return 0;
+}
+
+void *nameindex_find_in_cu(struct nameindex *index, const char *name,
+        void *cu){
+    for(struct nameentry *e = first_entry(index, name); e; e = e->ne_next){
+        if(e->ne_cu == cu)
+            return e->ne_die;
+    }
+
+    return NULL;
+}
+
+/* Call fn with every name, DIE, and compilation unit in the index.
+ * Entries with the same name are visited together, in the order
+ * they were added.
+ */
+void nameindex_walk(struct nameindex *index,
+        void (*fn)(const char *, void *, void *, void *), void *arg){
+    struct hashmap *chains = index->ni_chains;
+
+    for(uint64_t i=0; i<chains->capacity; i++){
+        if(!chains->entries[i].used)
+            continue;
+
+        struct namechain *chain = chains->entries[i].value;
+
+        for(struct nameentry *e = chain->nc_first; e; e = e->ne_next)
+            fn(e->ne_name, e->ne_die, e->ne_cu, arg);
+    }
+}
+
+void nameindex_free(struct nameindex *index){
+    if(!index)
+        return;
+
+    struct hashmap *chains = index->ni_chains;
+
+    for(uint64_t i=0; i<chains->capacity; i++){
+        if(!chains->entries[i].used)
+            continue;
+
+        struct namechain *chain = chains->entries[i].value;
+        struct nameentry *e = chain->nc_first;
+
+        while(e){
+            struct nameentry *next = e->ne_next;
+            free(e);
+            e = next;
+        }
+
+        free(chain);
+    }
+
+    hashmap_free(chains);
+    free(index);
+}
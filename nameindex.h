@@ -0,0 +1,12 @@
+#ifndef _NAMEINDEX_H_
+#define _NAMEINDEX_H_
+
+void nameindex_add(void *, const char *, void *, void *, int);
+int nameindex_find(void *, const char *, int, void ***, void ***, int *);
+void *nameindex_find_in_cu(void *, const char *, void *);
+void nameindex_free(void *);
+void *nameindex_new(void);
+void nameindex_walk(void *, void (*)(const char *, void *, void *, void *),
+        void *);
+
+#endif
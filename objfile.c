@@ -0,0 +1,848 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <libdwarf.h>
+#include <zlib.h>
+
+/* Just enough of ELF and Mach-O to find sections. Our own definitions
+ * so this builds without <elf.h> or <mach-o/loader.h>.
+ */
+#define ELF_MAGIC "\177ELF"
+#define ELFCLASS32 (1)
+#define ELFCLASS64 (2)
+#define ELFDATA2LSB (1)
+#define ELFDATA2MSB (2)
+#define ET_EXEC (2)
+#define ET_DYN (3)
+#define SHT_NOBITS (8)
+#define SHF_COMPRESSED (1 << 11)
+#define ELFCOMPRESS_ZLIB (1)
+
+/* Deflate can't do better than about 1032 to 1, anything claiming to
+ * inflate to more than this much per compressed byte is corrupt.
+ */
+#define ZLIB_MAX_RATIO (1032)
+
+#define MH_MAGIC_64 (0xfeedfacf)
+#define LC_SEGMENT_64 (0x19)
+
+struct elf64_ehdr {
+    unsigned char e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint64_t e_entry;
+    uint64_t e_phoff;
+    uint64_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+};
+
+struct elf64_shdr {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint64_t sh_flags;
+    uint64_t sh_addr;
+    uint64_t sh_offset;
+    uint64_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint64_t sh_addralign;
+    uint64_t sh_entsize;
+};
+
+struct elf32_ehdr {
+    unsigned char e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint32_t e_entry;
+    uint32_t e_phoff;
+    uint32_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+};
+
+struct elf64_chdr {
+    uint32_t ch_type;
+    uint32_t ch_reserved;
+    uint64_t ch_size;
+    uint64_t ch_addralign;
+};
+
+struct elf32_chdr {
+    uint32_t ch_type;
+    uint32_t ch_size;
+    uint32_t ch_addralign;
+};
+
+struct elf32_shdr {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint32_t sh_flags;
+    uint32_t sh_addr;
+    uint32_t sh_offset;
+    uint32_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint32_t sh_addralign;
+    uint32_t sh_entsize;
+};
+
+struct mach_header_64 {
+    uint32_t magic;
+    int32_t cputype;
+    int32_t cpusubtype;
+    uint32_t filetype;
+    uint32_t ncmds;
+    uint32_t sizeofcmds;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+struct load_command {
+    uint32_t cmd;
+    uint32_t cmdsize;
+};
+
+struct segment_command_64 {
+    uint32_t cmd;
+    uint32_t cmdsize;
+    char segname[16];
+    uint64_t vmaddr;
+    uint64_t vmsize;
+    uint64_t fileoff;
+    uint64_t filesize;
+    int32_t maxprot;
+    int32_t initprot;
+    uint32_t nsects;
+    uint32_t flags;
+};
+
+struct section_64 {
+    char sectname[16];
+    char segname[16];
+    uint64_t addr;
+    uint64_t size;
+    uint32_t offset;
+    uint32_t align;
+    uint32_t reloff;
+    uint32_t nreloc;
+    uint32_t flags;
+    uint32_t reserved1;
+    uint32_t reserved2;
+    uint32_t reserved3;
+};
+
+struct objsection {
+    Dwarf_Obj_Access_Section os_info;
+
+    /* Points into the mapping, NULL for sections with no file data.
+     * For compressed sections, NULL until they're inflated to the heap.
+     */
+    unsigned char *os_data;
+
+    /* Compressed sections' zlib stream, NULL for everything else.
+     * os_info.size is the inflated size. Inflated the first time any
+     * Dwarf_Debug loads the section, then shared, see inflate_section.
+     */
+    const unsigned char *os_zdata;
+    uint64_t os_zsize;
+    int os_inflatefailed;
+    pthread_mutex_t os_lock;
+
+    /* os_info.name points here for Mach-O, where names aren't
+     * NUL terminated and have to be translated, and for .zdebug_
+     * sections, which libdwarf would try to inflate again.
+     */
+    char os_name[24];
+};
+
+/* A DWARF file mapped read only, or a caller's buffer holding one.
+ * libdwarf reads sections straight out of it instead of copying them
+ * to the heap, and every Dwarf_Debug opened on it shares it.
+ */
+struct objfile {
+    unsigned char *of_map;
+    size_t of_mapsize;
+
+    /* Set if we mapped of_map, otherwise the caller owns it */
+    int of_ismapped;
+
+    /* Section 0 is always an empty placeholder, like ELF's */
+    struct objsection *of_sections;
+    Dwarf_Unsigned of_numsections;
+
+    Dwarf_Endianness of_byteorder;
+    Dwarf_Small of_pointersize;
+
+    Dwarf_Obj_Access_Interface of_interface;
+};
+
+static int objfile_get_section_info(void *obj, Dwarf_Half idx,
+        Dwarf_Obj_Access_Section *sectout, int *error){
+    struct objfile *of = obj;
+
+    *error = DW_DLE_NONE;
+
+    if(idx >= of->of_numsections)
+        return DW_DLV_NO_ENTRY;
+
+    *sectout = of->of_sections[idx].os_info;
+
+    return DW_DLV_OK;
+}
+
+static Dwarf_Endianness objfile_get_byte_order(void *obj){
+    return ((struct objfile *)obj)->of_byteorder;
+}
+
+/* Offset size of 32 bit DWARF, libdwarf figures out 64 bit DWARF
+ * from each unit's initial length.
+ */
+static Dwarf_Small objfile_get_length_size(void *obj){
+    return 4;
+}
+
+static Dwarf_Small objfile_get_pointer_size(void *obj){
+    return ((struct objfile *)obj)->of_pointersize;
+}
+
+static Dwarf_Unsigned objfile_get_section_count(void *obj){
+    return ((struct objfile *)obj)->of_numsections;
+}
+
+/* Returns 1 if the section is corrupt. Inflating happens outside
+ * any other section's lock, so different threads can inflate
+ * different sections at once.
+ */
+static int inflate_section(struct objsection *sect){
+    pthread_mutex_lock(&sect->os_lock);
+
+    if(!sect->os_data && !sect->os_inflatefailed){
+        uint64_t size = sect->os_info.size;
+        unsigned char *data = NULL;
+
+        /* The size comes from the file, don't trust it */
+        if(size <= (sect->os_zsize + 1) * ZLIB_MAX_RATIO &&
+                size == (uLongf)size && size == (size_t)size){
+            data = malloc(size ? size : 1);
+        }
+
+        if(data){
+            uLongf len = size;
+
+            int ret = uncompress(data, &len, sect->os_zdata,
+                    sect->os_zsize);
+
+            if(ret == Z_OK && len == size)
+                sect->os_data = data;
+            else
+                free(data);
+        }
+
+        if(!sect->os_data)
+            sect->os_inflatefailed = 1;
+    }
+
+    int failed = sect->os_inflatefailed;
+
+    pthread_mutex_unlock(&sect->os_lock);
+
+    return failed;
+}
+
+static int objfile_load_section(void *obj, Dwarf_Half idx,
+        Dwarf_Small **dataout, int *error){
+    struct objfile *of = obj;
+
+    *error = DW_DLE_NONE;
+
+    if(idx >= of->of_numsections)
+        return DW_DLV_NO_ENTRY;
+
+    struct objsection *sect = &of->of_sections[idx];
+
+    if(sect->os_zdata){
+        if(inflate_section(sect)){
+            *error = DW_DLE_ZLIB_UNCOMPRESS_ERROR;
+            return DW_DLV_ERROR;
+        }
+
+        *dataout = sect->os_data;
+
+        return DW_DLV_OK;
+    }
+
+    if(!sect->os_data)
+        return DW_DLV_NO_ENTRY;
+
+    /* libdwarf is about to go through this section, start reading
+     * it in now.
+     */
+    if(of->of_ismapped){
+        uintptr_t pagesz = (uintptr_t)sysconf(_SC_PAGESIZE);
+        uintptr_t start = (uintptr_t)sect->os_data & ~(pagesz - 1);
+        uintptr_t end = (uintptr_t)sect->os_data + sect->os_info.size;
+
+        madvise((void *)start, end - start, MADV_WILLNEED);
+    }
+
+    *dataout = sect->os_data;
+
+    return DW_DLV_OK;
+}
+
+/* We only take files whose DWARF doesn't need relocating */
+static int objfile_relocate_a_section(void *obj, Dwarf_Half idx,
+        Dwarf_Debug dbg, int *error){
+    *error = DW_DLE_NONE;
+    return DW_DLV_NO_ENTRY;
+}
+
+static const Dwarf_Obj_Access_Methods OBJFILE_METHODS = {
+    objfile_get_section_info,
+    objfile_get_byte_order,
+    objfile_get_length_size,
+    objfile_get_pointer_size,
+    objfile_get_section_count,
+    objfile_load_section,
+    objfile_relocate_a_section
+};
+
+static int range_fits(struct objfile *of, uint64_t off, uint64_t size){
+    return off <= of->of_mapsize && size <= of->of_mapsize - off;
+}
+
+static Dwarf_Endianness host_byte_order(void){
+    const uint16_t one = 1;
+
+    return *(const unsigned char *)&one ? DW_OBJECT_LSB : DW_OBJECT_MSB;
+}
+
+static void set_compressed(struct objsection *sect,
+        const unsigned char *zdata, uint64_t zsize, uint64_t inflatedsize){
+    sect->os_zdata = zdata;
+    sect->os_zsize = zsize;
+    sect->os_info.size = inflatedsize;
+
+    pthread_mutex_init(&sect->os_lock, NULL);
+}
+
+/* SHF_COMPRESSED sections start with a header of the file's class.
+ * Returns 1 for anything but zlib, libelf may know what to do with it.
+ */
+static int add_compressed_section(struct objfile *of,
+        struct objsection *sect, const unsigned char *data, uint64_t size){
+    uint32_t type;
+    uint64_t inflatedsize, hdrsize;
+
+    if(of->of_pointersize == 8){
+        struct elf64_chdr chdr;
+
+        if(size < sizeof(chdr))
+            return 1;
+
+        memcpy(&chdr, data, sizeof(chdr));
+        type = chdr.ch_type;
+        inflatedsize = chdr.ch_size;
+        hdrsize = sizeof(chdr);
+    }
+    else{
+        struct elf32_chdr chdr;
+
+        if(size < sizeof(chdr))
+            return 1;
+
+        memcpy(&chdr, data, sizeof(chdr));
+        type = chdr.ch_type;
+        inflatedsize = chdr.ch_size;
+        hdrsize = sizeof(chdr);
+    }
+
+    if(type != ELFCOMPRESS_ZLIB)
+        return 1;
+
+    set_compressed(sect, data + hdrsize, size - hdrsize, inflatedsize);
+
+    return 0;
+}
+
+/* Fill in one section from an ELF section header, whichever class
+ * it came from. Returns 1 if the file is something we can't map.
+ */
+static int add_elf_section(struct objfile *of, struct objsection *sect,
+        const char *shstrtab, uint64_t shstrtabsz, uint32_t name,
+        uint32_t type, uint64_t flags, uint64_t addr, uint64_t offset,
+        uint64_t size, uint32_t link, uint32_t info, uint64_t entsize){
+    if(name >= shstrtabsz || !memchr(shstrtab + name, '\0', shstrtabsz - name))
+        return 1;
+
+    sect->os_info.name = shstrtab + name;
+    sect->os_info.type = type;
+    sect->os_info.addr = addr;
+    sect->os_info.link = link;
+    sect->os_info.info = info;
+    sect->os_info.entrysize = entsize;
+
+    if(type == SHT_NOBITS)
+        return 0;
+
+    if(!range_fits(of, offset, size))
+        return 1;
+
+    const unsigned char *data = of->of_map + offset;
+
+    if(flags & SHF_COMPRESSED)
+        return add_compressed_section(of, sect, data, size);
+
+    const char *zdebug = ".zdebug_";
+
+    /* GNU's older format, "ZLIB" and the inflated size, big endian */
+    if(strncmp(sect->os_info.name, zdebug, strlen(zdebug)) == 0){
+        if(size < 12 || memcmp(data, "ZLIB", 4) != 0)
+            return 1;
+
+        uint64_t inflatedsize = 0;
+
+        for(int i=4; i<12; i++)
+            inflatedsize = (inflatedsize << 8) | data[i];
+
+        size_t namelen = strlen(sect->os_info.name) - 1;
+
+        if(namelen >= sizeof(sect->os_name))
+            return 1;
+
+        snprintf(sect->os_name, sizeof(sect->os_name), ".%s",
+                sect->os_info.name + 2);
+        sect->os_info.name = sect->os_name;
+
+        set_compressed(sect, data + 12, size - 12, inflatedsize);
+
+        return 0;
+    }
+
+    sect->os_info.size = size;
+    sect->os_data = (unsigned char *)data;
+
+    return 0;
+}
+
+static int parse_elf64(struct objfile *of){
+    if(of->of_mapsize < sizeof(struct elf64_ehdr))
+        return 1;
+
+    const struct elf64_ehdr *ehdr = (const void *)of->of_map;
+
+    if(ehdr->e_type != ET_EXEC && ehdr->e_type != ET_DYN)
+        return 1;
+
+    if(ehdr->e_shentsize != sizeof(struct elf64_shdr) || ehdr->e_shnum == 0 ||
+            ehdr->e_shstrndx >= ehdr->e_shnum ||
+            !range_fits(of, ehdr->e_shoff,
+                (uint64_t)ehdr->e_shnum * sizeof(struct elf64_shdr))){
+        return 1;
+    }
+
+    const struct elf64_shdr *shdrs = (const void *)(of->of_map + ehdr->e_shoff);
+    const struct elf64_shdr *strhdr = &shdrs[ehdr->e_shstrndx];
+
+    if(!range_fits(of, strhdr->sh_offset, strhdr->sh_size))
+        return 1;
+
+    const char *shstrtab = (const char *)(of->of_map + strhdr->sh_offset);
+
+    of->of_pointersize = 8;
+    of->of_numsections = ehdr->e_shnum;
+    of->of_sections = calloc(ehdr->e_shnum, sizeof(struct objsection));
+
+    for(uint16_t i=1; i<ehdr->e_shnum; i++){
+        const struct elf64_shdr *s = &shdrs[i];
+
+        if(add_elf_section(of, &of->of_sections[i], shstrtab,
+                    strhdr->sh_size, s->sh_name, s->sh_type, s->sh_flags,
+                    s->sh_addr, s->sh_offset, s->sh_size, s->sh_link,
+                    s->sh_info, s->sh_entsize)){
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int parse_elf32(struct objfile *of){
+    if(of->of_mapsize < sizeof(struct elf32_ehdr))
+        return 1;
+
+    const struct elf32_ehdr *ehdr = (const void *)of->of_map;
+
+    if(ehdr->e_type != ET_EXEC && ehdr->e_type != ET_DYN)
+        return 1;
+
+    if(ehdr->e_shentsize != sizeof(struct elf32_shdr) || ehdr->e_shnum == 0 ||
+            ehdr->e_shstrndx >= ehdr->e_shnum ||
+            !range_fits(of, ehdr->e_shoff,
+                (uint64_t)ehdr->e_shnum * sizeof(struct elf32_shdr))){
+        return 1;
+    }
+
+    const struct elf32_shdr *shdrs = (const void *)(of->of_map + ehdr->e_shoff);
+    const struct elf32_shdr *strhdr = &shdrs[ehdr->e_shstrndx];
+
+    if(!range_fits(of, strhdr->sh_offset, strhdr->sh_size))
+        return 1;
+
+    const char *shstrtab = (const char *)(of->of_map + strhdr->sh_offset);
+
+    of->of_pointersize = 4;
+    of->of_numsections = ehdr->e_shnum;
+    of->of_sections = calloc(ehdr->e_shnum, sizeof(struct objsection));
+
+    for(uint16_t i=1; i<ehdr->e_shnum; i++){
+        const struct elf32_shdr *s = &shdrs[i];
+
+        if(add_elf_section(of, &of->of_sections[i], shstrtab,
+                    strhdr->sh_size, s->sh_name, s->sh_type, s->sh_flags,
+                    s->sh_addr, s->sh_offset, s->sh_size, s->sh_link,
+                    s->sh_info, s->sh_entsize)){
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int parse_elf(struct objfile *of){
+    const unsigned char *ident = of->of_map;
+    Dwarf_Endianness order = ident[5] == ELFDATA2LSB ? DW_OBJECT_LSB :
+        DW_OBJECT_MSB;
+
+    /* Section headers are read in place */
+    if(ident[5] != ELFDATA2LSB && ident[5] != ELFDATA2MSB)
+        return 1;
+
+    if(order != host_byte_order())
+        return 1;
+
+    of->of_byteorder = order;
+
+    if(ident[4] == ELFCLASS64)
+        return parse_elf64(of);
+    else if(ident[4] == ELFCLASS32)
+        return parse_elf32(of);
+
+    return 1;
+}
+
+/* dSYMs keep their DWARF in the __DWARF segment, in sections named
+ * like __debug_info. libdwarf wants ELF style names.
+ */
+static int parse_macho64(struct objfile *of){
+    if(of->of_mapsize < sizeof(struct mach_header_64))
+        return 1;
+
+    const struct mach_header_64 *mh = (const void *)of->of_map;
+
+    if(!range_fits(of, sizeof(struct mach_header_64), mh->sizeofcmds))
+        return 1;
+
+    const unsigned char *cmds = of->of_map + sizeof(struct mach_header_64);
+    const unsigned char *end = cmds + mh->sizeofcmds;
+
+    of->of_byteorder = host_byte_order();
+    of->of_pointersize = 8;
+    of->of_numsections = 1;
+    of->of_sections = calloc(1, sizeof(struct objsection));
+
+    const unsigned char *cur = cmds;
+
+    for(uint32_t i=0; i<mh->ncmds; i++){
+        if(end - cur < (long)sizeof(struct load_command))
+            return 1;
+
+        const struct load_command *lc = (const void *)cur;
+
+        if(lc->cmdsize < sizeof(struct load_command) ||
+                lc->cmdsize > (uint64_t)(end - cur)){
+            return 1;
+        }
+
+        if(lc->cmd == LC_SEGMENT_64){
+            if(lc->cmdsize < sizeof(struct segment_command_64))
+                return 1;
+
+            const struct segment_command_64 *seg = (const void *)cur;
+            const struct section_64 *sects = (const void *)(seg + 1);
+
+            if(seg->nsects > (lc->cmdsize - sizeof(*seg)) / sizeof(*sects))
+                return 1;
+
+            struct objsection *sections_rea = realloc(of->of_sections,
+                    sizeof(struct objsection) *
+                    (of->of_numsections + seg->nsects));
+            of->of_sections = sections_rea;
+
+            for(uint32_t k=0; k<seg->nsects; k++){
+                const struct section_64 *s = &sects[k];
+                struct objsection *sect =
+                    &of->of_sections[of->of_numsections++];
+
+                memset(sect, 0, sizeof(struct objsection));
+
+                char sectname[17] = {0};
+                memcpy(sectname, s->sectname, sizeof(s->sectname));
+
+                const char *name = sectname;
+
+                if(strncmp(name, "__", 2) == 0){
+                    sect->os_name[0] = '.';
+                    name += 2;
+                }
+
+                strncat(sect->os_name, name, sizeof(sect->os_name) - 2);
+
+                sect->os_info.name = sect->os_name;
+                sect->os_info.addr = s->addr;
+
+                /* Zero fill sections have no file data */
+                if(s->offset == 0)
+                    continue;
+
+                if(!range_fits(of, s->offset, s->size))
+                    return 1;
+
+                sect->os_info.size = s->size;
+                sect->os_data = of->of_map + s->offset;
+            }
+        }
+
+        cur += lc->cmdsize;
+    }
+
+    return 0;
+}
+
+void objfile_close(struct objfile *of){
+    if(!of)
+        return;
+
+    for(Dwarf_Unsigned i=0; i<of->of_numsections; i++){
+        struct objsection *sect = &of->of_sections[i];
+
+        if(!sect->os_zdata)
+            continue;
+
+        free(sect->os_data);
+        pthread_mutex_destroy(&sect->os_lock);
+    }
+
+    if(of->of_ismapped)
+        munmap(of->of_map, of->of_mapsize);
+
+    free(of->of_sections);
+    free(of);
+}
+
+static struct objfile *objfile_parse(unsigned char *data, size_t size,
+        int ismapped){
+    struct objfile *of = calloc(1, sizeof(struct objfile));
+    of->of_map = data;
+    of->of_mapsize = size;
+    of->of_ismapped = ismapped;
+
+    int ret = 1;
+
+    if(size >= 16 && memcmp(data, ELF_MAGIC, 4) == 0)
+        ret = parse_elf(of);
+    else if(size >= 16 && *(uint32_t *)data == MH_MAGIC_64)
+        ret = parse_macho64(of);
+
+    if(ret){
+        objfile_close(of);
+        return NULL;
+    }
+
+    of->of_interface.object = of;
+    of->of_interface.methods = &OBJFILE_METHODS;
+
+    return of;
+}
+
+/* Returns NULL if path isn't a non-relocatable ELF file or a thin
+ * 64 bit Mach-O file in our byte order, the caller should let libdwarf
+ * open it normally instead.
+ */
+struct objfile *objfile_open(const char *path){
+    int fd = open(path, O_RDONLY);
+
+    if(fd < 0)
+        return NULL;
+
+    struct stat st;
+
+    if(fstat(fd, &st) || st.st_size < 16){
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+
+    if(map == MAP_FAILED)
+        return NULL;
+
+    struct objfile *of = objfile_parse(map, st.st_size, 1);
+
+    if(!of)
+        return NULL;
+
+    /* DIE trees and line programs are read mostly front to back, but
+     * .debug_str and .debug_abbrev get jumped around in, so leave
+     * readahead to the per section hints.
+     */
+    madvise(of->of_map, of->of_mapsize, MADV_RANDOM);
+
+    return of;
+}
+
+/* Same as objfile_open, but for an image that's already in memory.
+ * Nothing is copied, buf has to outlive the objfile.
+ */
+struct objfile *objfile_open_buffer(const void *buf, size_t size){
+    return objfile_parse((unsigned char *)buf, size, 0);
+}
+
+/* For sections we parse ourselves instead of through libdwarf.
+ * Returns 1 if of doesn't have one named name with file data.
+ */
+int objfile_get_section(struct objfile *of, const char *name,
+        const unsigned char **dataout, uint64_t *sizeout){
+    for(Dwarf_Unsigned i=1; i<of->of_numsections; i++){
+        struct objsection *sect = &of->of_sections[i];
+
+        if(strcmp(sect->os_info.name, name) != 0)
+            continue;
+
+        if(sect->os_zdata && inflate_section(sect))
+            return 1;
+
+        if(!sect->os_data)
+            return 1;
+
+        *dataout = sect->os_data;
+        *sizeout = sect->os_info.size;
+
+        return 0;
+    }
+
+    return 1;
+}
+
+/* 4 or 8, the class of the file */
+int objfile_get_pointersize(struct objfile *of){
+    return of->of_pointersize;
+}
+
+struct inflate_queue {
+    pthread_mutex_t iq_lock;
+    struct objsection **iq_sections;
+    int iq_numsections;
+    int iq_next;
+};
+
+static void *inflate_thread(void *arg){
+    struct inflate_queue *queue = arg;
+
+    for(;;){
+        pthread_mutex_lock(&queue->iq_lock);
+        int idx = queue->iq_next++;
+        pthread_mutex_unlock(&queue->iq_lock);
+
+        if(idx >= queue->iq_numsections)
+            break;
+
+        inflate_section(queue->iq_sections[idx]);
+    }
+
+    return NULL;
+}
+
+/* Inflate whichever of these compressed sections aren't yet, on up
+ * to numthreads threads. A zlib stream can only be inflated front to
+ * back, so each section is inflated whole by one thread.
+ */
+void objfile_inflate_sections(struct objfile *of, const char **names,
+        int numnames, int numthreads){
+    struct inflate_queue queue = {0};
+    queue.iq_sections = calloc(numnames, sizeof(struct objsection *));
+
+    for(Dwarf_Unsigned i=1; i<of->of_numsections; i++){
+        struct objsection *sect = &of->of_sections[i];
+
+        if(!sect->os_zdata || sect->os_data)
+            continue;
+
+        for(int k=0; k<numnames; k++){
+            if(strcmp(sect->os_info.name, names[k]) == 0 &&
+                    queue.iq_numsections < numnames){
+                queue.iq_sections[queue.iq_numsections++] = sect;
+                break;
+            }
+        }
+    }
+
+    if(numthreads > queue.iq_numsections)
+        numthreads = queue.iq_numsections;
+
+    pthread_mutex_init(&queue.iq_lock, NULL);
+
+    pthread_t *threads = calloc(numthreads + 1, sizeof(pthread_t));
+
+    int numstarted = 0;
+
+    /* The calling thread is one of them. If some of the rest couldn't
+     * start, it just inflates more.
+     */
+    for(int i=0; i<numthreads - 1; i++){
+        if(pthread_create(&threads[i], NULL, inflate_thread, &queue) != 0)
+            break;
+
+        numstarted++;
+    }
+
+    inflate_thread(&queue);
+
+    for(int i=0; i<numstarted; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_mutex_destroy(&queue.iq_lock);
+    free(threads);
+    free(queue.iq_sections);
+}
+
+/* Every Dwarf_Debug opened on of shares its mapping, close them all
+ * with dwarf_object_finish before objfile_close.
+ */
+int objfile_dwarf_init(struct objfile *of, Dwarf_Debug *dbgout,
+        Dwarf_Error *d_error){
+    return dwarf_object_init_b(&of->of_interface, NULL, NULL,
+            DW_GROUPNUMBER_ANY, dbgout, d_error);
+}
@@ -0,0 +1,18 @@
+#ifndef _OBJFILE_H_
+#define _OBJFILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct objfile;
+
+void objfile_close(struct objfile *);
+int objfile_dwarf_init(struct objfile *, Dwarf_Debug *, Dwarf_Error *);
+int objfile_get_pointersize(struct objfile *);
+int objfile_get_section(struct objfile *, const char *,
+        const unsigned char **, uint64_t *);
+void objfile_inflate_sections(struct objfile *, const char **, int, int);
+struct objfile *objfile_open(const char *);
+struct objfile *objfile_open_buffer(const void *, size_t);
+
+#endif
@@ -0,0 +1,128 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "hashmap.h"
+
+/* Split up so threads building different compilation units don't
+ * all wait on one lock.
+ */
+#define STRTAB_NUMSHARDS (16)
+#define STRTAB_CHUNK_SIZE (64 * 1024)
+
+struct strtab_entry {
+    struct strtab_entry *se_next;
+    char se_str[];
+};
+
+struct strtab_shard {
+    pthread_mutex_t ss_lock;
+
+    /* String hash to a chain of entries with that hash */
+    struct hashmap *ss_chains;
+
+    /* Entries and the strings in them */
+    struct arena *ss_arena;
+};
+
+/* Every distinct name we've seen, stored once. Pointers handed out
+ * stay valid until strtab_free, so two interned strings are equal if
+ * and only if their pointers are.
+ */
+struct strtab {
+    struct strtab_shard st_shards[STRTAB_NUMSHARDS];
+};
+
+struct strtab *strtab_new(void){
+    struct strtab *strtab = malloc(sizeof(struct strtab));
+
+    for(int i=0; i<STRTAB_NUMSHARDS; i++){
+        struct strtab_shard *shard = &strtab->st_shards[i];
+
+        pthread_mutex_init(&shard->ss_lock, NULL);
+        shard->ss_chains = hashmap_new();
+        shard->ss_arena = arena_new(STRTAB_CHUNK_SIZE);
+    }
+
+    return strtab;
+}
+
+static struct strtab_shard *get_shard(struct strtab *strtab, uint64_t hash){
+    return &strtab->st_shards[hash % STRTAB_NUMSHARDS];
+}
+
+/* Caller holds the shard's lock */
+static const char *find_in_shard(struct strtab_shard *shard, uint64_t hash,
+        const char *str){
+    struct strtab_entry *entry = hashmap_get(shard->ss_chains, hash);
+
+    while(entry){
+        if(strcmp(entry->se_str, str) == 0)
+            return entry->se_str;
+
+        entry = entry->se_next;
+    }
+
+    return NULL;
+}
+
+const char *strtab_intern(struct strtab *strtab, const char *str){
+    if(!str)
+        return NULL;
+
+    uint64_t hash = hash_string(str);
+    struct strtab_shard *shard = get_shard(strtab, hash);
+
+    pthread_mutex_lock(&shard->ss_lock);
+
+    const char *interned = find_in_shard(shard, hash, str);
+
+    if(!interned){
+        size_t len = strlen(str) + 1;
+        struct strtab_entry *entry = arena_alloc(shard->ss_arena,
+                sizeof(struct strtab_entry) + len);
+
+        memcpy(entry->se_str, str, len);
+
+        entry->se_next = hashmap_get(shard->ss_chains, hash);
+        hashmap_set(shard->ss_chains, hash, entry);
+
+        interned = entry->se_str;
+    }
+
+    pthread_mutex_unlock(&shard->ss_lock);
+
+    return interned;
+}
+
+/* Like strtab_intern, but returns NULL instead of adding str */
+const char *strtab_lookup(struct strtab *strtab, const char *str){
+    if(!str)
+        return NULL;
+
+    uint64_t hash = hash_string(str);
+    struct strtab_shard *shard = get_shard(strtab, hash);
+
+    pthread_mutex_lock(&shard->ss_lock);
+    const char *interned = find_in_shard(shard, hash, str);
+    pthread_mutex_unlock(&shard->ss_lock);
+
+    return interned;
+}
+
+void strtab_free(struct strtab *strtab){
+    if(!strtab)
+        return;
+
+    for(int i=0; i<STRTAB_NUMSHARDS; i++){
+        struct strtab_shard *shard = &strtab->st_shards[i];
+
+        pthread_mutex_destroy(&shard->ss_lock);
+        hashmap_free(shard->ss_chains);
+        arena_free(shard->ss_arena);
+    }
+
+    free(strtab);
+}
@@ -0,0 +1,9 @@
+#ifndef _STRTAB_H_
+#define _STRTAB_H_
+
+const char *strtab_intern(void *, const char *);
+const char *strtab_lookup(void *, const char *);
+void strtab_free(void *);
+void *strtab_new(void);
+
+#endif
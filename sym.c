@@ -5,16 +5,48 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "appleaccel.h"
 #include "common.h"
 #include "compunit.h"
+#include "debugnames.h"
 #include "die.h"
+#include "elfsym.h"
+#include "gdbindex.h"
+#include "hashmap.h"
 #include "linkedlist.h"
+#include "nameindex.h"
+#include "objfile.h"
+#include "strtab.h"
+#include "symcache.h"
 #include "symerr.h"
+#include "symflags.h"
+#include "sympcinfo.h"
+#include "typecache.h"
+#include "typeunify.h"
 
 #include <libdwarf.h>
 
-int sym_init_with_dwarf_file(const char *file, dwarfinfo_t **_dwarfinfo,
+/* Everything after we have a Dwarf_Debug is the same no matter where
+ * the DWARF came from.
+ */
+static int load_dwarfinfo(dwarfinfo_t *dwarfinfo, int flags,
         sym_error_t *e){
+    dwarfinfo->di_flags = flags;
+    dwarfinfo->di_compunits = linkedlist_new();
+    dwarfinfo->di_numcompunits = 0;
+    dwarfinfo->di_nameindex = nameindex_new();
+    dwarfinfo->di_dieoffsets = hashmap_new();
+    dwarfinfo->di_strtab = strtab_new();
+    dwarfinfo->di_typecache = typecache_new();
+
+    if(flags & SYM_INIT_UNIFY_TYPES)
+        dwarfinfo->di_typeunify = typeunify_new();
+
+    return cu_load_compilation_units(dwarfinfo, e);
+}
+
+int sym_init_with_dwarf_file_flags(const char *file, int flags,
+        dwarfinfo_t **_dwarfinfo, sym_error_t *e){
     int fd = open(file, O_RDONLY);
 
     if(fd < 0){
@@ -24,19 +56,39 @@ int sym_init_with_dwarf_file(const char *file, dwarfinfo_t **_dwarfinfo,
 
     dwarfinfo_t *dwarfinfo = calloc(1, sizeof(dwarfinfo_t));
     Dwarf_Error d_error = NULL;
-    int ret = dwarf_init(fd, DW_DLC_READ, NULL, NULL,
-            &dwarfinfo->di_dbg, &d_error);
+    int ret = DW_DLV_NO_ENTRY;
+
+    /* Read sections straight out of a mapping of the file if we can,
+     * libelf copies every one of them to the heap.
+     */
+    dwarfinfo->di_objfile = objfile_open(file);
+
+    if(dwarfinfo->di_objfile){
+        ret = objfile_dwarf_init(dwarfinfo->di_objfile, &dwarfinfo->di_dbg,
+                &d_error);
+
+        if(ret != DW_DLV_OK){
+            objfile_close(dwarfinfo->di_objfile);
+            dwarfinfo->di_objfile = NULL;
+        }
+    }
+
+    if(ret != DW_DLV_OK){
+        ret = dwarf_init(fd, DW_DLC_READ, NULL, NULL,
+                &dwarfinfo->di_dbg, &d_error);
+    }
 
     if(ret != DW_DLV_OK){
         errset(e, SYM_ERROR_KIND, SYM_DWARF_INIT_FAILED);
+        close(fd);
         free(dwarfinfo);
         return 1;
     }
 
-    dwarfinfo->di_compunits = linkedlist_new();
-    dwarfinfo->di_numcompunits = 0;
+    dwarfinfo->di_fd = fd;
+    dwarfinfo->di_path = strdup(file);
 
-    if(cu_load_compilation_units(dwarfinfo, e))
+    if(load_dwarfinfo(dwarfinfo, flags, e))
         return 1;
 
     *_dwarfinfo = dwarfinfo;
@@ -44,6 +96,51 @@ int sym_init_with_dwarf_file(const char *file, dwarfinfo_t **_dwarfinfo,
     return 0;
 }
 
+int sym_init_with_dwarf_buffer(const void *buf, size_t len, int flags,
+        dwarfinfo_t **_dwarfinfo, sym_error_t *e){
+    if(!buf || !_dwarfinfo){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_PARAMETER);
+        return 1;
+    }
+
+    dwarfinfo_t *dwarfinfo = calloc(1, sizeof(dwarfinfo_t));
+    Dwarf_Error d_error = NULL;
+
+    /* There's no file for libelf to fall back on */
+    dwarfinfo->di_objfile = objfile_open_buffer(buf, len);
+
+    if(!dwarfinfo->di_objfile || objfile_dwarf_init(dwarfinfo->di_objfile,
+                &dwarfinfo->di_dbg, &d_error) != DW_DLV_OK){
+        errset(e, SYM_ERROR_KIND, SYM_DWARF_INIT_FAILED);
+        objfile_close(dwarfinfo->di_objfile);
+        free(dwarfinfo);
+        return 1;
+    }
+
+    dwarfinfo->di_fd = -1;
+
+    if(load_dwarfinfo(dwarfinfo, flags, e))
+        return 1;
+
+    *_dwarfinfo = dwarfinfo;
+
+    return 0;
+}
+
+int sym_init_with_dwarf_file(const char *file, dwarfinfo_t **_dwarfinfo,
+        sym_error_t *e){
+    return sym_init_with_dwarf_file_flags(file, 0, _dwarfinfo, e);
+}
+
+static void finish_dbg(dwarfinfo_t *dwarfinfo, Dwarf_Debug dbg){
+    Dwarf_Error d_error = NULL;
+
+    if(dwarfinfo->di_objfile)
+        dwarf_object_finish(dbg, &d_error);
+    else
+        dwarf_finish(dbg, &d_error);
+}
+
 void sym_end(dwarfinfo_t **_dwarfinfo){
     if(!_dwarfinfo || !(*_dwarfinfo))
         return;
@@ -54,26 +151,78 @@ void sym_end(dwarfinfo_t **_dwarfinfo){
 
     while(current){
         void *cu = current->data;
-        void *root_die = NULL;
-
-        cu_get_root_die(cu, &root_die, NULL);
 
         current = current->next;
 
-        die_tree_free(dwarfinfo->di_dbg, root_die, 0);
         linkedlist_delete(dwarfinfo->di_compunits, cu);
         cu_free(cu, NULL);
     }
 
-    close(dwarfinfo->di_fd);
+    for(int i=0; i<dwarfinfo->di_numworkers; i++){
+        finish_dbg(dwarfinfo, dwarfinfo->di_workerdbgs[i]);
 
-    Dwarf_Error d_error = NULL;
-    int ret = dwarf_finish(dwarfinfo->di_dbg, &d_error);
+        if(dwarfinfo->di_workerfds[i] >= 0)
+            close(dwarfinfo->di_workerfds[i]);
+    }
+
+    free(dwarfinfo->di_workerdbgs);
+    free(dwarfinfo->di_workerfds);
+
+    /* Split objects are tied to di_dbg, so they go first */
+    if(dwarfinfo->di_dwpdbg){
+        Dwarf_Error d_error = NULL;
+
+        dwarf_finish(dwarfinfo->di_dwpdbg, &d_error);
+        close(dwarfinfo->di_dwpfd);
+    }
+
+    finish_dbg(dwarfinfo, dwarfinfo->di_dbg);
+
+    /* Nothing reads from the mapping anymore */
+    debugnames_free(dwarfinfo->di_debugnames);
+    appleaccel_free(dwarfinfo->di_applenames);
+    appleaccel_free(dwarfinfo->di_appletypes);
+    gdbindex_free(dwarfinfo->di_gdbindex);
+    elfsym_free(dwarfinfo->di_elfsym);
+    objfile_close(dwarfinfo->di_objfile);
+
+    if(dwarfinfo->di_fd >= 0)
+        close(dwarfinfo->di_fd);
+
+    free(dwarfinfo->di_path);
 
     linkedlist_free(dwarfinfo->di_compunits);
+    nameindex_free(dwarfinfo->di_nameindex);
+    hashmap_free(dwarfinfo->di_dieoffsets);
+    strtab_free(dwarfinfo->di_strtab);
+    typecache_free(dwarfinfo->di_typecache);
+    typeunify_free(dwarfinfo->di_typeunify);
+    symcache_close(dwarfinfo->di_symcache);
+    free(dwarfinfo->di_symcachecus);
+    free(dwarfinfo->di_curanges);
     free(dwarfinfo);
 }
 
+int sym_get_unified_types_savings(dwarfinfo_t *dwarfinfo, uint64_t *savedout,
+        sym_error_t *e){
+    if(!dwarfinfo){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_DWARFINFO);
+        return 1;
+    }
+
+    if(!savedout){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_PARAMETER);
+        return 1;
+    }
+
+    *savedout = 0;
+
+    if(dwarfinfo->di_typeunify)
+        *savedout = typeunify_get_savings(dwarfinfo->di_typeunify);
+
+    return 0;
+}
+
 int sym_display_compilation_units(dwarfinfo_t *dwarfinfo,
         sym_error_t *e){
     return cu_display_compilation_units(dwarfinfo, e);
@@ -91,11 +240,7 @@ int sym_get_compilation_unit_root_die(void *cu, void **dieout,
 
 int sym_create_variable_or_parameter_die_desc(void *die, void *cu,
         char **desc, sym_error_t *e){
-    void *root_die = NULL;
-    if(cu_get_root_die(cu, &root_die, e))
-        return 1;
-
-    return die_create_variable_or_parameter_desc(die, root_die, desc, e, 0);
+    return die_create_variable_or_parameter_desc(die, cu, desc, e, 0);
 }
 
 void sym_display_die(void *die){
@@ -113,16 +258,13 @@ int sym_evaluate_die_location_description(void *die, uint64_t pc,
 
 int sym_find_die_by_name(void *cu, const char *name, void **dieout,
         sym_error_t *e){
-    void *root_die = NULL;
-    if(cu_get_root_die(cu, &root_die, e))
-        return 1;
-
-    void *result = NULL;
-    int ret = die_search(root_die, (void *)name, DIE_SEARCH_IF_NAME_MATCHES,
-            &result, e);
+    return cu_find_die_by_name(cu, name, dieout, e);
+}
 
-    *dieout = result;
-    return ret;
+int sym_find_dies_by_name(dwarfinfo_t *dwarfinfo, const char *name, int tag,
+        void ***diesout, void ***cusout, int *lenout, sym_error_t *e){
+    return cu_find_dies_by_name(dwarfinfo, name, tag, diesout, cusout,
+            lenout, e);
 }
 
 int sym_find_function_die_by_pc(void *cu, uint64_t pc, void **dieout,
@@ -166,11 +308,7 @@ int sym_get_die_low_pc(void *die, uint64_t *lowpcout, sym_error_t *e){
 
 int sym_get_die_members(void *die, void *cu, void ***membersout,
         int *membersarrlen, sym_error_t *e){
-    void *root_die = NULL;
-    if(cu_get_root_die(cu, &root_die, e))
-        return 1;
-
-    return die_get_members(die, root_die, membersout, membersarrlen, e);
+    return die_get_members(die, cu, membersout, membersarrlen, e);
 }
 
 int sym_get_die_name(void *die, char **dienameout, sym_error_t *e){
@@ -226,9 +364,311 @@ int sym_is_die_a_member_of_struct_or_union(void *die, int *retval,
     return die_is_member_of_struct_or_union(die, retval, e);
 }
 
+static struct elfsym *get_elfsym(dwarfinfo_t *dwarfinfo){
+    if(dwarfinfo->di_elfsymtried)
+        return dwarfinfo->di_elfsym;
+
+    dwarfinfo->di_elfsymtried = 1;
+
+    struct objfile *of = dwarfinfo->di_objfile;
+
+    if(!of)
+        return NULL;
+
+    static const char *const tables[][2] = {
+        { ".symtab", ".strtab" },
+        { ".dynsym", ".dynstr" }
+    };
+
+    struct elfsym *es = elfsym_new();
+    int found = 0;
+
+    for(size_t i=0; i<sizeof(tables) / sizeof(*tables); i++){
+        const unsigned char *syms, *str;
+        uint64_t symsize, strsize;
+
+        if(objfile_get_section(of, tables[i][0], &syms, &symsize) ||
+                objfile_get_section(of, tables[i][1], &str, &strsize)){
+            continue;
+        }
+
+        elfsym_add_symbols(es, syms, symsize, str, strsize,
+                objfile_get_pointersize(of));
+        found = 1;
+    }
+
+    if(!found){
+        elfsym_free(es);
+        return NULL;
+    }
+
+    elfsym_finish(es);
+
+    dwarfinfo->di_elfsym = es;
+
+    return es;
+}
+
+/* Name and offset of the function symbol containing pc, for when no
+ * compilation unit covers it.
+ */
+static int find_elf_symbol(dwarfinfo_t *dwarfinfo, uint64_t pc,
+        const char **nameout, uint64_t *offsetout){
+    struct elfsym *es = get_elfsym(dwarfinfo);
+
+    if(!es)
+        return 1;
+
+    return elfsym_find(es, pc, nameout, offsetout);
+}
+
+int sym_get_symbol_from_pc(dwarfinfo_t *dwarfinfo, uint64_t pc,
+        char **nameout, uint64_t *offsetout, sym_error_t *e){
+    if(!dwarfinfo){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_DWARFINFO);
+        return 1;
+    }
+
+    if(!nameout || !offsetout){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_PARAMETER);
+        return 1;
+    }
+
+    void *cu = NULL, *fxndie = NULL;
+
+    if(!cu_find_compilation_unit_by_pc(dwarfinfo, &cu, pc, NULL) &&
+            !sym_find_function_die_by_pc(cu, pc, &fxndie, NULL)){
+        uint64_t lowpc = 0;
+        char *name = NULL;
+
+        die_get_low_pc(fxndie, &lowpc, NULL);
+        die_get_name(fxndie, &name, NULL);
+
+        if(name){
+            *nameout = name;
+            *offsetout = pc - lowpc;
+            return 0;
+        }
+    }
+
+    const char *name = NULL;
+
+    if(find_elf_symbol(dwarfinfo, pc, &name, offsetout)){
+        errset(e, SYM_ERROR_KIND, SYM_SYMBOL_NOT_FOUND);
+        return 1;
+    }
+
+    *nameout = (char *)name;
+
+    return 0;
+}
+
+struct batchpc {
+    uint64_t bp_pc;
+    int bp_idx;
+};
+
+static int batchpc_cmp(const void *a, const void *b){
+    const struct batchpc *pa = a, *pb = b;
+
+    if(pa->bp_pc != pb->bp_pc)
+        return pa->bp_pc < pb->bp_pc ? -1 : 1;
+
+    return pa->bp_idx - pb->bp_idx;
+}
+
+/* Fill in results for sorted[start] to sorted[end - 1], which all
+ * belong to cu.
+ */
+static void symbolize_cu_run(void *cu, struct batchpc *sorted,
+        const uint64_t *pcs, int start, int end, sym_pcinfo_t *results,
+        const char **filenames, uint64_t *linenos, void **fxndies){
+    void *root_die = NULL;
+    int n = end - start;
+
+    if(cu_get_root_die(cu, &root_die, NULL) ||
+            die_get_line_info_from_sorted_pcs(root_die, pcs + start, n,
+                filenames, linenos, fxndies, NULL)){
+        return;
+    }
+
+    for(int i=0; i<n; i++){
+        sym_pcinfo_t *r = &results[sorted[start + i].bp_idx];
+        r->srcfilename = filenames[i];
+        r->srcfilelineno = linenos[i];
+
+        if(fxndies[i]){
+            uint64_t lowpc = 0;
+            char *name = NULL;
+
+            die_get_low_pc(fxndies[i], &lowpc, NULL);
+            die_get_name(fxndies[i], &name, NULL);
+
+            r->srcfunction = name;
+            r->srcfunctionoffset = pcs[start + i] - lowpc;
+        }
+    }
+}
+
+int sym_symbolize_batch(dwarfinfo_t *dwarfinfo, const uint64_t *pcs,
+        int n, sym_pcinfo_t *results, sym_error_t *e){
+    if(!dwarfinfo){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_DWARFINFO);
+        return 1;
+    }
+
+    if(n < 0 || (n > 0 && (!pcs || !results))){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_PARAMETER);
+        return 1;
+    }
+
+    if(n == 0)
+        return 0;
+
+    memset(results, 0, sizeof(sym_pcinfo_t) * n);
+
+    /* Sorting lets every lookup below pick up where the last one
+     * left off, and groups PCs by compilation unit.
+     */
+    struct batchpc *sorted = malloc(sizeof(struct batchpc) * n);
+
+    for(int i=0; i<n; i++){
+        sorted[i].bp_pc = pcs[i];
+        sorted[i].bp_idx = i;
+    }
+
+    qsort(sorted, n, sizeof(struct batchpc), batchpc_cmp);
+
+    uint64_t *sortedpcs = malloc(sizeof(uint64_t) * n);
+    void **cus = malloc(sizeof(void *) * n);
+    const char **filenames = malloc(sizeof(char *) * n);
+    uint64_t *linenos = malloc(sizeof(uint64_t) * n);
+    void **fxndies = malloc(sizeof(void *) * n);
+
+    for(int i=0; i<n; i++)
+        sortedpcs[i] = sorted[i].bp_pc;
+
+    cu_find_compilation_units_by_sorted_pcs(dwarfinfo, sortedpcs, n, cus);
+
+    int start = 0;
+
+    while(start < n){
+        int end = start + 1;
+
+        while(end < n && cus[end] == cus[start])
+            end++;
+
+        if(cus[start]){
+            for(int i=start; i<end; i++)
+                results[sorted[i].bp_idx].cu = cus[start];
+
+            symbolize_cu_run(cus[start], sorted, sortedpcs, start, end,
+                    results, filenames, linenos, fxndies);
+        }
+
+        start = end;
+    }
+
+    /* Whatever DWARF didn't name, the symbol table might */
+    for(int i=0; i<n; i++){
+        sym_pcinfo_t *r = &results[sorted[i].bp_idx];
+
+        if(r->srcfunction)
+            continue;
+
+        if(i > 0 && sortedpcs[i] == sortedpcs[i - 1]){
+            sym_pcinfo_t *prev = &results[sorted[i - 1].bp_idx];
+
+            r->srcfunction = prev->srcfunction;
+            r->srcfunctionoffset = prev->srcfunctionoffset;
+            continue;
+        }
+
+        const char *name = NULL;
+        uint64_t offset = 0;
+
+        if(!find_elf_symbol(dwarfinfo, sortedpcs[i], &name, &offset)){
+            r->srcfunction = name;
+            r->srcfunctionoffset = offset;
+        }
+    }
+
+    free(fxndies);
+    free(linenos);
+    free(filenames);
+    free(cus);
+    free(sortedpcs);
+    free(sorted);
+
+    return 0;
+}
+
+/* "name+0x1c" */
+static char *symbol_with_offset(const char *name, uint64_t offset){
+    size_t len = strlen(name) + sizeof("+0x") + 16;
+    char *str = malloc(len);
+    snprintf(str, len, "%s+%#llx", name, (unsigned long long)offset);
+
+    return str;
+}
+
 int sym_get_line_info_from_pc(dwarfinfo_t *dwarfinfo, uint64_t pc,
         char **outsrcfilename, char **outsrcfunction,
         uint64_t *outsrcfilelineno, void **cudieout, sym_error_t *e){
+    void *cu = NULL, *root_die = NULL;
+    int ret = 1;
+
+    if(!cu_find_compilation_unit_by_pc(dwarfinfo, &cu, pc, e)){
+        if(cu_get_root_die(cu, &root_die, e))
+            return 1;
+
+        ret = die_get_line_info_from_pc(dwarfinfo->di_dbg, root_die, pc,
+                outsrcfilename, outsrcfunction, outsrcfilelineno, e);
+
+        if(!ret && *outsrcfunction){
+            *cudieout = root_die;
+            return 0;
+        }
+    }
+
+    if(!dwarfinfo)
+        return 1;
+
+    /* Nothing in DWARF says what function pc is in, the symbol table
+     * might. Keep whatever line info we did get.
+     */
+    if(ret){
+        *outsrcfilename = NULL;
+        *outsrcfilelineno = 0;
+    }
+
+    const char *name = NULL;
+    uint64_t offset = 0;
+
+    if(find_elf_symbol(dwarfinfo, pc, &name, &offset)){
+        if(!ret){
+            free(*outsrcfilename);
+            *outsrcfilename = NULL;
+            *outsrcfilelineno = 0;
+
+            errset(e, DIE_ERROR_KIND, DIE_DIE_NOT_FOUND);
+        }
+
+        return 1;
+    }
+
+    errclear(e);
+
+    *outsrcfunction = symbol_with_offset(name, offset);
+
+    /* Only the symbol table covers pc if no compilation unit does */
+    *cudieout = cu ? root_die : NULL;
+
+    return 0;
+}
+
+int sym_get_inlined_frames_from_pc(dwarfinfo_t *dwarfinfo, uint64_t pc,
+        sym_inlineframe_t **framesout, int *lenout, sym_error_t *e){
     void *cu = NULL;
     if(cu_find_compilation_unit_by_pc(dwarfinfo, &cu, pc, e))
         return 1;
@@ -237,11 +677,8 @@ int sym_get_line_info_from_pc(dwarfinfo_t *dwarfinfo, uint64_t pc,
     if(cu_get_root_die(cu, &root_die, e))
         return 1;
 
-    int ret = die_get_line_info_from_pc(dwarfinfo->di_dbg, root_die, pc,
-            outsrcfilename, outsrcfunction, outsrcfilelineno, e);
-
-    *cudieout = root_die;
-    return 0;
+    return die_get_inlined_frames_from_pc(root_die, cu, pc,
+            (void **)framesout, lenout, e);
 }
 
 int sym_get_pc_of_next_line(dwarfinfo_t *dwarfinfo, uint64_t pc,
@@ -276,6 +713,82 @@ int sym_get_pc_values_from_lineno(dwarfinfo_t *dwarfinfo, void *cu,
             pcs, len, e);
 }
 
+static int pc_cmp(const void *a, const void *b){
+    uint64_t pa = *(const uint64_t *)a, pb = *(const uint64_t *)b;
+
+    if(pa == pb)
+        return 0;
+
+    return pa < pb ? -1 : 1;
+}
+
+int sym_get_pc_values_from_file_lineno(dwarfinfo_t *dwarfinfo, void *cu,
+        const char *file, uint64_t lineno, uint64_t **pcs, int *len,
+        sym_error_t *e){
+    if(!dwarfinfo){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_DWARFINFO);
+        return 1;
+    }
+
+    if(cu){
+        void *root_die = NULL;
+        if(cu_get_root_die(cu, &root_die, e))
+            return 1;
+
+        return die_get_pc_values_from_file_lineno(dwarfinfo->di_dbg,
+                root_die, file, lineno, pcs, len, e);
+    }
+
+    if(!file || !pcs || !len){
+        errset(e, GENERIC_ERROR_KIND, GE_INVALID_PARAMETER);
+        return 1;
+    }
+
+    /* A header's lines can be in any compilation unit that includes it */
+    uint64_t *all = calloc(1, sizeof(uint64_t));
+    int alllen = 0;
+
+    LL_FOREACH(dwarfinfo->di_compunits, current){
+        void *root_die = NULL;
+
+        if(cu_get_root_die(current->data, &root_die, e)){
+            free(all);
+            return 1;
+        }
+
+        uint64_t *cupcs = NULL;
+        int cupcslen = 0;
+
+        die_get_pc_values_from_file_lineno(dwarfinfo->di_dbg, root_die, file,
+                lineno, &cupcs, &cupcslen, NULL);
+
+        if(cupcslen > 0){
+            uint64_t *all_rea = realloc(all,
+                    sizeof(uint64_t) * (alllen + cupcslen));
+            all = all_rea;
+
+            memcpy(all + alllen, cupcs, sizeof(uint64_t) * cupcslen);
+            alllen += cupcslen;
+        }
+
+        free(cupcs);
+    }
+
+    qsort(all, alllen, sizeof(uint64_t), pc_cmp);
+
+    int unique = 0;
+
+    for(int i=0; i<alllen; i++){
+        if(unique == 0 || all[unique - 1] != all[i])
+            all[unique++] = all[i];
+    }
+
+    *pcs = all;
+    *len = unique;
+
+    return 0;
+}
+
 int sym_lineno_to_pc_a(dwarfinfo_t *dwarfinfo,
         char *srcfilename, uint64_t *srcfilelineno, uint64_t *pcout,
         sym_error_t *e){
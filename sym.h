@@ -2,6 +2,8 @@
 #define _SYM_H_
 
 #include "symerr.h"
+#include "symflags.h"
+#include "sympcinfo.h"
 
 /*
  * Almost all of these functions return 0 on success and non-zero on error.
@@ -18,9 +20,37 @@ int sym_init_with_dwarf_file(
         void **         /* return dwarfinfo ptr */,
         void *          /* return error ptr */);
 
+/* Same as sym_init_with_dwarf_file, but takes SYM_INIT_* flags. */
+int sym_init_with_dwarf_file_flags(
+        const char *    /* dSYM file path */,
+        int             /* SYM_INIT_* flags */,
+        void **         /* return dwarfinfo ptr */,
+        void *          /* return error ptr */);
+
+/* Same as sym_init_with_dwarf_file_flags, but reads an ELF or Mach-O
+ * image the caller already has in memory. The buffer isn't copied, so
+ * it must stay around until sym_end, and be aligned at least as much
+ * as malloc would. SYM_INIT_INDEX_CACHE is ignored, there's no file to
+ * key the cache on.
+ */
+int sym_init_with_dwarf_buffer(
+        const void *    /* image */,
+        size_t          /* image length */,
+        int             /* SYM_INIT_* flags */,
+        void **         /* return dwarfinfo ptr */,
+        void *          /* return error ptr */);
+
 void sym_end(
         void **     /* dwarfinfo ptr */);
 
+/* How many bytes of DIEs SYM_INIT_UNIFY_TYPES got rid of so far,
+ * 0 without it.
+ */
+int sym_get_unified_types_savings(
+        void *      /* dwarfinfo ptr */,
+        uint64_t *  /* return bytes saved */,
+        void *      /* return error ptr */);
+
 
 /* Compilation unit related functions */
 int sym_display_compilation_units(
@@ -64,6 +94,21 @@ int sym_find_die_by_name(
         void **         /* return die */,
         void *          /* return error ptr */);
 
+/* Searches every compilation unit for DIEs named name. If tag is
+ * non-zero, only DIEs with that DW_TAG_* are returned. The DIE array and
+ * the parallel array of the compilation units they belong to must be
+ * freed, their contents must not. Lazily loaded compilation units are
+ * built first.
+ */
+int sym_find_dies_by_name(
+        void *          /* dwarfinfo ptr */,
+        const char *    /* name */,
+        int             /* DW_TAG_* or 0 */,
+        void ***        /* return die array */,
+        void ***        /* return compilation unit array */,
+        int *           /* return array len */,
+        void *          /* return error ptr */);
+
 int sym_find_function_die_by_pc(
         void *      /* compilation unit */,
         uint64_t    /* pc */,
@@ -178,7 +223,26 @@ int sym_is_die_a_member_of_struct_or_union(
 
 /* Line related functions */
 
-/* Returns CU DIE which this line resides in */
+/* Name of the function containing pc and how far into it pc is. Comes
+ * from DWARF if a compilation unit covers pc, otherwise from the
+ * function symbols in .symtab and .dynsym. The name must not be freed.
+ */
+int sym_get_symbol_from_pc(
+        void *      /* dwarfinfo ptr */,
+        uint64_t    /* pc */,
+        char **     /* return function name */,
+        uint64_t *  /* return offset into function */,
+        void *      /* return error ptr */);
+
+/* Returns CU DIE which this line resides in. The function is the name
+ * of the function DIE containing pc. If no function DIE does, but a
+ * function symbol from .symtab or .dynsym does, the function is that
+ * symbol's name followed by pc's offset into it in hex, like
+ * "memcpy+0x1c". sym_get_symbol_from_pc returns the name and offset
+ * separately. Without line info, the file name is NULL and the line
+ * is 0. If only a symbol covers pc, there's no compilation unit and
+ * the CU DIE is NULL, so check it before passing it to anything else.
+ */
 int sym_get_line_info_from_pc(
         void *      /* dwarfinfo ptr */,
         uint64_t    /* pc */,
@@ -188,6 +252,33 @@ int sym_get_line_info_from_pc(
         void **     /* return CU DIE */,
         void *      /* return error ptr */);
 
+/* Symbolize many PCs at once, like a backtrace or profiler samples.
+ * results must have room for as many PCs as there are, result i is
+ * for PC i. PCs are sorted internally, so each compilation unit, line
+ * table, and function index is searched once per run of nearby PCs.
+ * Unlike sym_get_line_info_from_pc, a PC doesn't have to start a line
+ * table row. PCs nothing covers get a result of all NULLs and zeros,
+ * that isn't an error.
+ */
+int sym_symbolize_batch(
+        void *              /* dwarfinfo ptr */,
+        const uint64_t *    /* PCs */,
+        int                 /* number of PCs */,
+        sym_pcinfo_t *      /* return results */,
+        void *              /* return error ptr */);
+
+/* Every function the code at a PC belongs to, innermost first. That's
+ * each inlined subroutine, then the subprogram they were inlined into.
+ * For code that wasn't inlined, it's just the subprogram. The array
+ * must be freed, its contents must not.
+ */
+int sym_get_inlined_frames_from_pc(
+        void *                  /* dwarfinfo ptr */,
+        uint64_t                /* pc */,
+        sym_inlineframe_t **    /* return frames */,
+        int *                   /* return number of frames */,
+        void *                  /* return error ptr */);
+
 /* This version takes in the dwarfinfo pointer.
  * It returns the CU DIE which the line resides in.
  */
@@ -207,6 +298,24 @@ int sym_get_pc_values_from_lineno(
         int *           /* return PC values array len */,
         void *          /* return error ptr */);
 
+/* Same, but only lines from one source file, like a breakpoint on
+ * file:line. The file can be a full path or the end of one, like
+ * "foo.c" or "src/foo.h". If the compilation unit is NULL, every
+ * compilation unit is searched, since a header's lines can be in any
+ * of them. A compilation unit's line table only exists once its DIE
+ * tree is built, so with SYM_INIT_LAZY this builds every tree that
+ * hasn't been built yet, which costs as much as a non-lazy sym_init.
+ * Pass a compilation unit to search only that one.
+ */
+int sym_get_pc_values_from_file_lineno(
+        void *          /* dwarfinfo ptr */,
+        void *          /* compilation unit or NULL */,
+        const char *    /* source file */,
+        uint64_t        /* lineno */,
+        uint64_t **     /* return PC values */,
+        int *           /* return PC values array len */,
+        void *          /* return error ptr */);
+
 /* Finds CU DIE based on srcfilename */
 int sym_lineno_to_pc_a(
         void *      /* dwarfinfo ptr */,
@@ -0,0 +1,606 @@
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hashmap.h"
+#include "symcache.h"
+
+/* A cache file is a header followed by these sections, each starting
+ * on an eight byte boundary:
+ *
+ *      compilation units   struct symcache_cu[sh_numcus]
+ *      PC ranges           struct symcache_range[sh_numranges]
+ *      name buckets        struct symcache_bucket[sh_numbuckets]
+ *      CU index lists      uint32_t[sh_numcuidxs]
+ *      strings             char[sh_strsize]
+ *
+ * Everything is in host byte order. A file written by a different
+ * version or on a machine with a different byte order is ignored and
+ * rewritten.
+ */
+#define SYMCACHE_MAGIC "LSYMIDX"
+#define SYMCACHE_VERSION (1)
+#define SYMCACHE_BYTE_ORDER (0x01020304)
+
+/* Hashing a multi-gigabyte file would take longer than parsing it,
+ * so the content hash covers this many evenly spaced pieces of it.
+ */
+#define SYMCACHE_NUMSAMPLES (16)
+#define SYMCACHE_SAMPLE_SIZE (4096)
+
+struct symcache_header {
+    char sh_magic[8];
+    uint32_t sh_version;
+    uint32_t sh_byteorder;
+
+    struct symcache_key sh_key;
+
+    uint32_t sh_numcus;
+    uint32_t sh_numranges;
+    uint32_t sh_numbuckets;
+    uint32_t sh_numcuidxs;
+
+    uint64_t sh_cusoff;
+    uint64_t sh_rangesoff;
+    uint64_t sh_bucketsoff;
+    uint64_t sh_cuidxsoff;
+    uint64_t sh_stroff;
+    uint64_t sh_strsize;
+
+    /* Size of the cache file itself */
+    uint64_t sh_filesize;
+};
+
+/* Every name in the index, in an open addressing hash table keyed
+ * by hash_string. sb_numcus compilation unit indexes starting at
+ * sb_cus in the CU index lists have a DIE with this name.
+ */
+struct symcache_bucket {
+    uint64_t sb_hash;
+    uint32_t sb_name;
+    uint32_t sb_numcus;
+    uint32_t sb_cus;
+    uint32_t sb_used;
+};
+
+struct symcache {
+    unsigned char *c_map;
+    size_t c_mapsize;
+
+    const struct symcache_header *c_hdr;
+};
+
+/* Which compilation units have a DIE with this name */
+struct pendingname {
+    uint32_t pn_name;
+    uint64_t pn_hash;
+
+    uint32_t *pn_cus;
+    uint32_t pn_numcus;
+    uint32_t pn_capacity;
+};
+
+/* Strings handed to the builder are expected to be interned, so
+ * they're deduplicated by pointer.
+ */
+struct symcache_builder {
+    struct symcache_cu *b_cus;
+    uint32_t b_numcus;
+    uint32_t b_cuscap;
+
+    struct symcache_range *b_ranges;
+    uint32_t b_numranges;
+    uint32_t b_rangescap;
+
+    char *b_strs;
+    uint64_t b_strsize;
+    uint64_t b_strcap;
+
+    /* String pointer to its offset in b_strs, plus one */
+    struct hashmap *b_stroffs;
+
+    /* Name pointer to its struct pendingname */
+    struct hashmap *b_names;
+    struct pendingname **b_namelist;
+    uint32_t b_numnames;
+    uint32_t b_namescap;
+};
+
+static uint64_t fnv1a(uint64_t hash, const unsigned char *data, size_t len){
+    for(size_t i=0; i<len; i++){
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+int symcache_compute_key(int fd, struct symcache_key *key){
+    struct stat st;
+
+    if(fstat(fd, &st))
+        return 1;
+
+    memset(key, 0, sizeof(struct symcache_key));
+
+    key->sk_size = st.st_size;
+#ifdef __APPLE__
+    key->sk_mtime_sec = st.st_mtimespec.tv_sec;
+    key->sk_mtime_nsec = st.st_mtimespec.tv_nsec;
+#else
+    key->sk_mtime_sec = st.st_mtim.tv_sec;
+    key->sk_mtime_nsec = st.st_mtim.tv_nsec;
+#endif
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    unsigned char sample[SYMCACHE_SAMPLE_SIZE];
+
+    for(int i=0; i<SYMCACHE_NUMSAMPLES; i++){
+        off_t off = 0;
+
+        if(key->sk_size > SYMCACHE_SAMPLE_SIZE){
+            off = ((key->sk_size - SYMCACHE_SAMPLE_SIZE) /
+                    (SYMCACHE_NUMSAMPLES - 1)) * i;
+        }
+
+        ssize_t got = pread(fd, sample, sizeof(sample), off);
+
+        if(got < 0)
+            return 1;
+
+        hash = fnv1a(hash, sample, got);
+    }
+
+    key->sk_hash = hash;
+
+    return 0;
+}
+
+static char *format_path(const char *fmt, ...){
+    va_list args;
+
+    va_start(args, fmt);
+    int len = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    if(len < 0)
+        return NULL;
+
+    char *path = malloc(len + 1);
+
+    va_start(args, fmt);
+    vsnprintf(path, len + 1, fmt, args);
+    va_end(args);
+
+    return path;
+}
+
+/* The cache goes next to the DWARF file, or in $LIBSYM_CACHE_DIR if
+ * that's set. Caller frees the returned path.
+ */
+char *symcache_path(const char *dwarfpath){
+    const char *dir = getenv("LIBSYM_CACHE_DIR");
+
+    if(!dir || !(*dir))
+        return format_path("%s.symcache", dwarfpath);
+
+    const char *base = strrchr(dwarfpath, '/');
+    base = base ? base + 1 : dwarfpath;
+
+    /* Different files can have the same name */
+    return format_path("%s/%s-%016llx.symcache", dir, base,
+            (unsigned long long)hash_string(dwarfpath));
+}
+
+struct symcache_builder *symcache_builder_new(void){
+    struct symcache_builder *b = calloc(1, sizeof(struct symcache_builder));
+
+    b->b_stroffs = hashmap_new();
+    b->b_names = hashmap_new();
+
+    return b;
+}
+
+uint32_t symcache_builder_add_string(struct symcache_builder *b,
+        const char *str){
+    if(!str)
+        return SYMCACHE_NO_NAME;
+
+    uint64_t off = (uintptr_t)hashmap_get(b->b_stroffs, (uintptr_t)str);
+
+    if(off)
+        return off - 1;
+
+    size_t len = strlen(str) + 1;
+
+    if(b->b_strsize + len > b->b_strcap){
+        b->b_strcap = (b->b_strcap ? b->b_strcap * 2 : 4096) + len;
+
+        char *strs_rea = realloc(b->b_strs, b->b_strcap);
+        b->b_strs = strs_rea;
+    }
+
+    off = b->b_strsize;
+
+    memcpy(b->b_strs + off, str, len);
+    b->b_strsize += len;
+
+    hashmap_set(b->b_stroffs, (uintptr_t)str, (void *)(uintptr_t)(off + 1));
+
+    return off;
+}
+
+void symcache_builder_add_cu(struct symcache_builder *b,
+        const struct symcache_cu *cu){
+    if(b->b_numcus == b->b_cuscap){
+        b->b_cuscap = b->b_cuscap ? b->b_cuscap * 2 : 64;
+
+        struct symcache_cu *cus_rea = realloc(b->b_cus,
+                sizeof(struct symcache_cu) * b->b_cuscap);
+        b->b_cus = cus_rea;
+    }
+
+    b->b_cus[b->b_numcus++] = *cu;
+}
+
+void symcache_builder_add_range(struct symcache_builder *b, uint64_t low,
+        uint64_t high, uint32_t cu){
+    if(b->b_numranges == b->b_rangescap){
+        b->b_rangescap = b->b_rangescap ? b->b_rangescap * 2 : 64;
+
+        struct symcache_range *ranges_rea = realloc(b->b_ranges,
+                sizeof(struct symcache_range) * b->b_rangescap);
+        b->b_ranges = ranges_rea;
+    }
+
+    struct symcache_range *r = &b->b_ranges[b->b_numranges++];
+    r->sr_low = low;
+    r->sr_high = high;
+    r->sr_cu = cu;
+}
+
+/* Say that compilation unit cu has a DIE called name */
+void symcache_builder_add_name(struct symcache_builder *b, const char *name,
+        uint32_t cu){
+    if(!name)
+        return;
+
+    struct pendingname *pn = hashmap_get(b->b_names, (uintptr_t)name);
+
+    if(!pn){
+        pn = calloc(1, sizeof(struct pendingname));
+        pn->pn_name = symcache_builder_add_string(b, name);
+        pn->pn_hash = hash_string(name);
+
+        hashmap_set(b->b_names, (uintptr_t)name, pn);
+
+        if(b->b_numnames == b->b_namescap){
+            b->b_namescap = b->b_namescap ? b->b_namescap * 2 : 1024;
+
+            struct pendingname **namelist_rea = realloc(b->b_namelist,
+                    sizeof(struct pendingname *) * b->b_namescap);
+            b->b_namelist = namelist_rea;
+        }
+
+        b->b_namelist[b->b_numnames++] = pn;
+    }
+
+    /* Names come in tree order, so repeats from the same compilation
+     * unit are next to each other.
+     */
+    if(pn->pn_numcus > 0 && pn->pn_cus[pn->pn_numcus - 1] == cu)
+        return;
+
+    if(pn->pn_numcus == pn->pn_capacity){
+        pn->pn_capacity = pn->pn_capacity ? pn->pn_capacity * 2 : 2;
+
+        uint32_t *cus_rea = realloc(pn->pn_cus,
+                sizeof(uint32_t) * pn->pn_capacity);
+        pn->pn_cus = cus_rea;
+    }
+
+    pn->pn_cus[pn->pn_numcus++] = cu;
+}
+
+static uint64_t align8(uint64_t off){
+    return (off + 7) & ~7ULL;
+}
+
+static int write_all(int fd, const void *data, size_t len){
+    const unsigned char *p = data;
+
+    while(len > 0){
+        ssize_t wrote = write(fd, p, len);
+
+        if(wrote <= 0)
+            return 1;
+
+        p += wrote;
+        len -= wrote;
+    }
+
+    return 0;
+}
+
+static int write_section(int fd, uint64_t *pos, uint64_t off,
+        const void *data, size_t len){
+    static const unsigned char zeros[8];
+
+    if(write_all(fd, zeros, off - *pos) || write_all(fd, data, len))
+        return 1;
+
+    *pos = off + len;
+
+    return 0;
+}
+
+/* The file is written under a temporary name and renamed into place,
+ * so nobody ever maps a partially written one.
+ */
+int symcache_builder_write(struct symcache_builder *b, const char *path,
+        const struct symcache_key *key){
+    uint32_t numbuckets = 16;
+
+    while(numbuckets < b->b_numnames * 2)
+        numbuckets *= 2;
+
+    struct symcache_bucket *buckets = calloc(numbuckets,
+            sizeof(struct symcache_bucket));
+
+    uint32_t numcuidxs = 0;
+
+    for(uint32_t i=0; i<b->b_numnames; i++)
+        numcuidxs += b->b_namelist[i]->pn_numcus;
+
+    uint32_t *cuidxs = malloc(sizeof(uint32_t) * (numcuidxs + 1));
+    uint32_t nextcuidx = 0;
+
+    for(uint32_t i=0; i<b->b_numnames; i++){
+        struct pendingname *pn = b->b_namelist[i];
+        uint32_t idx = pn->pn_hash & (numbuckets - 1);
+
+        while(buckets[idx].sb_used)
+            idx = (idx + 1) & (numbuckets - 1);
+
+        struct symcache_bucket *bucket = &buckets[idx];
+        bucket->sb_hash = pn->pn_hash;
+        bucket->sb_name = pn->pn_name;
+        bucket->sb_numcus = pn->pn_numcus;
+        bucket->sb_cus = nextcuidx;
+        bucket->sb_used = 1;
+
+        memcpy(&cuidxs[nextcuidx], pn->pn_cus, sizeof(uint32_t) *
+                pn->pn_numcus);
+        nextcuidx += pn->pn_numcus;
+    }
+
+    struct symcache_header hdr = {0};
+    memcpy(hdr.sh_magic, SYMCACHE_MAGIC, sizeof(hdr.sh_magic));
+    hdr.sh_version = SYMCACHE_VERSION;
+    hdr.sh_byteorder = SYMCACHE_BYTE_ORDER;
+    hdr.sh_key = *key;
+    hdr.sh_numcus = b->b_numcus;
+    hdr.sh_numranges = b->b_numranges;
+    hdr.sh_numbuckets = numbuckets;
+    hdr.sh_numcuidxs = numcuidxs;
+
+    hdr.sh_cusoff = align8(sizeof(hdr));
+    hdr.sh_rangesoff = align8(hdr.sh_cusoff +
+            sizeof(struct symcache_cu) * b->b_numcus);
+    hdr.sh_bucketsoff = align8(hdr.sh_rangesoff +
+            sizeof(struct symcache_range) * b->b_numranges);
+    hdr.sh_cuidxsoff = align8(hdr.sh_bucketsoff +
+            sizeof(struct symcache_bucket) * numbuckets);
+    hdr.sh_stroff = align8(hdr.sh_cuidxsoff + sizeof(uint32_t) * numcuidxs);
+    hdr.sh_strsize = b->b_strsize;
+    hdr.sh_filesize = hdr.sh_stroff + hdr.sh_strsize;
+
+    char *tmppath = format_path("%s.%d.tmp", path, (int)getpid());
+    int fd = tmppath ? open(tmppath, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    int ret = 1;
+
+    if(fd >= 0){
+        uint64_t pos = 0;
+
+        ret = write_section(fd, &pos, 0, &hdr, sizeof(hdr)) ||
+            write_section(fd, &pos, hdr.sh_cusoff, b->b_cus,
+                    sizeof(struct symcache_cu) * b->b_numcus) ||
+            write_section(fd, &pos, hdr.sh_rangesoff, b->b_ranges,
+                    sizeof(struct symcache_range) * b->b_numranges) ||
+            write_section(fd, &pos, hdr.sh_bucketsoff, buckets,
+                    sizeof(struct symcache_bucket) * numbuckets) ||
+            write_section(fd, &pos, hdr.sh_cuidxsoff, cuidxs,
+                    sizeof(uint32_t) * numcuidxs) ||
+            write_section(fd, &pos, hdr.sh_stroff, b->b_strs, b->b_strsize);
+
+        close(fd);
+
+        if(!ret)
+            ret = rename(tmppath, path) != 0;
+
+        if(ret)
+            unlink(tmppath);
+    }
+
+    free(tmppath);
+    free(buckets);
+    free(cuidxs);
+
+    return ret;
+}
+
+void symcache_builder_free(struct symcache_builder *b){
+    if(!b)
+        return;
+
+    for(uint32_t i=0; i<b->b_numnames; i++){
+        free(b->b_namelist[i]->pn_cus);
+        free(b->b_namelist[i]);
+    }
+
+    free(b->b_namelist);
+    hashmap_free(b->b_names);
+    hashmap_free(b->b_stroffs);
+    free(b->b_strs);
+    free(b->b_ranges);
+    free(b->b_cus);
+    free(b);
+}
+
+static int section_fits(const struct symcache_header *hdr, uint64_t off,
+        uint64_t count, uint64_t elemsz){
+    return off <= hdr->sh_filesize &&
+        count <= (hdr->sh_filesize - off) / elemsz;
+}
+
+static int header_is_valid(const struct symcache_header *hdr,
+        size_t mapsize, const struct symcache_key *key){
+    if(memcmp(hdr->sh_magic, SYMCACHE_MAGIC, sizeof(hdr->sh_magic)) ||
+            hdr->sh_version != SYMCACHE_VERSION ||
+            hdr->sh_byteorder != SYMCACHE_BYTE_ORDER){
+        return 0;
+    }
+
+    if(memcmp(&hdr->sh_key, key, sizeof(struct symcache_key)))
+        return 0;
+
+    if(hdr->sh_filesize != mapsize)
+        return 0;
+
+    /* Need a power of two for lookups to work */
+    if(hdr->sh_numbuckets == 0 ||
+            (hdr->sh_numbuckets & (hdr->sh_numbuckets - 1))){
+        return 0;
+    }
+
+    return section_fits(hdr, hdr->sh_cusoff, hdr->sh_numcus,
+            sizeof(struct symcache_cu)) &&
+        section_fits(hdr, hdr->sh_rangesoff, hdr->sh_numranges,
+                sizeof(struct symcache_range)) &&
+        section_fits(hdr, hdr->sh_bucketsoff, hdr->sh_numbuckets,
+                sizeof(struct symcache_bucket)) &&
+        section_fits(hdr, hdr->sh_cuidxsoff, hdr->sh_numcuidxs,
+                sizeof(uint32_t)) &&
+        section_fits(hdr, hdr->sh_stroff, hdr->sh_strsize, 1);
+}
+
+/* Returns NULL if there's no cache file, or if it was built from
+ * something other than what key describes.
+ */
+struct symcache *symcache_open(const char *path,
+        const struct symcache_key *key){
+    int fd = open(path, O_RDONLY);
+
+    if(fd < 0)
+        return NULL;
+
+    struct stat st;
+
+    if(fstat(fd, &st) || st.st_size < (off_t)sizeof(struct symcache_header)){
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+
+    if(map == MAP_FAILED)
+        return NULL;
+
+    const struct symcache_header *hdr = map;
+
+    if(!header_is_valid(hdr, st.st_size, key)){
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    struct symcache *cache = malloc(sizeof(struct symcache));
+    cache->c_map = map;
+    cache->c_mapsize = st.st_size;
+    cache->c_hdr = hdr;
+
+    return cache;
+}
+
+const struct symcache_cu *symcache_get_cus(struct symcache *cache,
+        uint32_t *lenout){
+    *lenout = cache->c_hdr->sh_numcus;
+    return (const void *)(cache->c_map + cache->c_hdr->sh_cusoff);
+}
+
+const struct symcache_range *symcache_get_ranges(struct symcache *cache,
+        uint32_t *lenout){
+    *lenout = cache->c_hdr->sh_numranges;
+    return (const void *)(cache->c_map + cache->c_hdr->sh_rangesoff);
+}
+
+const char *symcache_get_string(struct symcache *cache, uint32_t off){
+    const struct symcache_header *hdr = cache->c_hdr;
+
+    if(off == SYMCACHE_NO_NAME || off >= hdr->sh_strsize)
+        return NULL;
+
+    const char *strs = (const char *)(cache->c_map + hdr->sh_stroff);
+
+    /* Make sure it ends before the file does */
+    if(!memchr(strs + off, '\0', hdr->sh_strsize - off))
+        return NULL;
+
+    return strs + off;
+}
+
+/* Returns 1 if no compilation unit has a DIE called name. Otherwise
+ * *cusout points into the cache, don't free it.
+ */
+int symcache_find_name(struct symcache *cache, const char *name,
+        const uint32_t **cusout, uint32_t *lenout){
+    const struct symcache_header *hdr = cache->c_hdr;
+    const struct symcache_bucket *buckets =
+        (const void *)(cache->c_map + hdr->sh_bucketsoff);
+    const uint32_t *cuidxs =
+        (const void *)(cache->c_map + hdr->sh_cuidxsoff);
+
+    uint64_t hash = hash_string(name);
+    uint32_t mask = hdr->sh_numbuckets - 1;
+
+    for(uint32_t idx = hash & mask, probes = 0;
+            buckets[idx].sb_used && probes < hdr->sh_numbuckets;
+            idx = (idx + 1) & mask, probes++){
+        const struct symcache_bucket *bucket = &buckets[idx];
+
+        if(bucket->sb_hash != hash)
+            continue;
+
+        const char *bucketname = symcache_get_string(cache, bucket->sb_name);
+
+        if(!bucketname || strcmp(bucketname, name))
+            continue;
+
+        if(bucket->sb_cus > hdr->sh_numcuidxs ||
+                bucket->sb_numcus > hdr->sh_numcuidxs - bucket->sb_cus){
+            return 1;
+        }
+
+        *cusout = &cuidxs[bucket->sb_cus];
+        *lenout = bucket->sb_numcus;
+
+        return 0;
+    }
+
+    return 1;
+}
+
+void symcache_close(struct symcache *cache){
+    if(!cache)
+        return;
+
+    munmap(cache->c_map, cache->c_mapsize);
+    free(cache);
+}
@@ -0,0 +1,72 @@
+#ifndef _SYMCACHE_H_
+#define _SYMCACHE_H_
+
+#include <stdint.h>
+
+#define SYMCACHE_NO_NAME ((uint32_t)-1)
+
+/* What a cache file was built from. A cache file is only used if
+ * every field matches the DWARF file we were given.
+ */
+struct symcache_key {
+    uint64_t sk_size;
+    int64_t sk_mtime_sec;
+    int64_t sk_mtime_nsec;
+    uint64_t sk_hash;
+};
+
+/* Everything cu_load_compilation_units reads out of a compilation
+ * unit's header and root DIE. These are written to the file as is.
+ */
+struct symcache_cu {
+    uint64_t sc_header_offset;
+    uint64_t sc_header_len;
+    uint64_t sc_abbrev_offset;
+    uint64_t sc_next_header_offset;
+    uint64_t sc_die_offset;
+    uint64_t sc_low_pc;
+    uint64_t sc_high_pc;
+
+    /* Offset into the string table, or SYMCACHE_NO_NAME */
+    uint32_t sc_name;
+
+    uint16_t sc_address_size;
+    uint16_t sc_hasranges;
+};
+
+struct symcache_range {
+    uint64_t sr_low;
+    uint64_t sr_high;
+
+    /* Index into the compilation unit table */
+    uint64_t sr_cu;
+};
+
+struct symcache;
+struct symcache_builder;
+
+void symcache_builder_add_cu(struct symcache_builder *,
+        const struct symcache_cu *);
+void symcache_builder_add_name(struct symcache_builder *, const char *,
+        uint32_t);
+void symcache_builder_add_range(struct symcache_builder *, uint64_t,
+        uint64_t, uint32_t);
+uint32_t symcache_builder_add_string(struct symcache_builder *,
+        const char *);
+void symcache_builder_free(struct symcache_builder *);
+struct symcache_builder *symcache_builder_new(void);
+int symcache_builder_write(struct symcache_builder *, const char *,
+        const struct symcache_key *);
+
+void symcache_close(struct symcache *);
+int symcache_compute_key(int, struct symcache_key *);
+int symcache_find_name(struct symcache *, const char *, const uint32_t **,
+        uint32_t *);
+const struct symcache_cu *symcache_get_cus(struct symcache *, uint32_t *);
+const struct symcache_range *symcache_get_ranges(struct symcache *,
+        uint32_t *);
+const char *symcache_get_string(struct symcache *, uint32_t);
+struct symcache *symcache_open(const char *, const struct symcache_key *);
+char *symcache_path(const char *);
+
+#endif
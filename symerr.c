@@ -19,13 +19,16 @@ static const char *const SYM_ERROR_TABLE[] = {
     "No error (0)",
     "dwarf_init failed (1 - sym error)",
     "dwarf_siblingof_b failed (2 - sym error)",
-    "dwarf_srclines failed (3 - sym error)"
+    "dwarf_srclines failed (3 - sym error)",
+    "dwarf_offdie_b failed (4 - sym error)",
+    "No symbol contains PC (5 - sym error)"
 };
 
 static const char *const CU_ERROR_TABLE[] = {
     "No error (0)",
     "Compilation unit not found (1 - compilation unit error)",
-    "dwarf_next_cu_header_d failed (2 - compilation unit error)"
+    "dwarf_next_cu_header_d failed (2 - compilation unit error)",
+    "dwarf_get_cu_die_offset_given_cu_header_offset_b failed (3 - compilation unit error)"
 };
 
 static const char *const DIE_ERROR_TABLE[] = {
@@ -27,13 +27,16 @@ enum {
     SYM_NO_ERROR = 0,
     SYM_DWARF_INIT_FAILED,
     SYM_DWARF_SIBLING_OF_B_FAILED,
-    SYM_DWARF_SRCLINES_FAILED
+    SYM_DWARF_SRCLINES_FAILED,
+    SYM_DWARF_OFFDIE_FAILED,
+    SYM_SYMBOL_NOT_FOUND
 };
 
 enum {
     CU_NO_ERROR = 0,
     CU_CU_NOT_FOUND,
     CU_DWARF_NEXT_CU_HEADER_D_FAILED,
+    CU_DWARF_GET_CU_DIE_OFFSET_FAILED
 };
 
 enum {
@@ -0,0 +1,46 @@
+#ifndef _SYMFLAGS_H_
+#define _SYMFLAGS_H_
+
+/* Flags for sym_init_with_dwarf_file_flags */
+enum {
+    /* Only read compilation unit headers at init. Each compilation unit
+     * builds its DIE tree and line table the first time a query touches
+     * it. Anonymous types and lexical blocks are numbered in the order
+     * compilation units get built. If the file has .debug_names or
+     * Apple's .apple_names and .apple_types, finding functions,
+     * variables, or types by name only builds the compilation units
+     * they list. DIEs they leave out, like declarations and local
+     * variables, are only found in compilation units that were
+     * already built. If the file has a .gdb_index, compilation units
+     * and their PC ranges come from it instead of .debug_info, and
+     * it's used for name lookups the same way.
+     */
+    SYM_INIT_LAZY =         (1 << 0),
+
+    /* Build compilation unit DIE trees and line tables on a pool of
+     * worker threads, one per online CPU. Ignored with SYM_INIT_LAZY
+     * or SYM_INIT_UNIFY_TYPES.
+     */
+    SYM_INIT_PARALLEL =     (1 << 1),
+
+    /* Named structures and unions that are laid out the same in more
+     * than one compilation unit keep one copy of their members, owned
+     * by whichever compilation unit was built first. Those members'
+     * parent is that compilation unit's type. See
+     * sym_get_unified_types_savings. Trees are built one at a time,
+     * in .debug_info order, even with SYM_INIT_PARALLEL, so the same
+     * compilation unit owns a type every time.
+     */
+    SYM_INIT_UNIFY_TYPES =  (1 << 2),
+
+    /* Keep an index of compilation unit headers, PC ranges, and which
+     * compilation units have a DIE with a given name in a file next
+     * to the DWARF file, or in $LIBSYM_CACHE_DIR. If there's an up to
+     * date one, it's mapped in place of reading every compilation unit
+     * and everything is loaded like SYM_INIT_LAZY. Otherwise every DIE
+     * tree is built, even with SYM_INIT_LAZY, and the file is written.
+     */
+    SYM_INIT_INDEX_CACHE =  (1 << 3)
+};
+
+#endif
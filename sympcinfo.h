@@ -0,0 +1,44 @@
+#ifndef _SYMPCINFO_H_
+#define _SYMPCINFO_H_
+
+#include <stdint.h>
+
+/* What sym_symbolize_batch found for one PC. None of these are copies,
+ * they're good until sym_end and must not be freed.
+ */
+typedef struct {
+    /* Source file name without its directory, NULL if no line
+     * table covers the PC.
+     */
+    const char *srcfilename;
+    uint64_t srcfilelineno;
+
+    /* Function containing the PC, from DWARF or else from the symbol
+     * table, NULL if neither has one.
+     */
+    const char *srcfunction;
+    uint64_t srcfunctionoffset;
+
+    /* Compilation unit covering the PC, NULL if none does */
+    void *cu;
+} sym_pcinfo_t;
+
+/* One function of what sym_get_inlined_frames_from_pc found at a PC.
+ * Like sym_pcinfo_t, nothing here is a copy.
+ */
+typedef struct {
+    const char *srcfunction;
+
+    /* Where in srcfunction the PC is. For the innermost frame, that's
+     * the line table's answer. For the rest, it's where the frame
+     * inside them was inlined.
+     */
+    const char *srcfilename;
+    uint64_t srcfilelineno;
+
+    /* Where this frame was inlined, NULL and 0 for the outermost */
+    const char *callfilename;
+    uint64_t calllineno;
+} sym_inlineframe_t;
+
+#endif
@@ -0,0 +1,9 @@
+static int twice(int x){
+    return x * 2;
+}
+
+int main(void){
+    int x = twice(21);
+
+    return x - 42;
+}
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sym.h"
+
+/* Line of "int x = twice(21);" in split.c */
+#define SPLIT_LINE (6)
+
+/* split.c is built with -gsplit-dwarf and its .dwo is deleted, so the
+ * skeleton unit is all there is. Its line table is in the main file,
+ * so line queries still work both ways.
+ */
+int main(int argc, char **argv){
+    if(argc < 2){
+        puts("need a dwarf file");
+        return 1;
+    }
+
+    sym_error_t e = {0};
+    void *dwarfinfo = NULL;
+
+    if(sym_init_with_dwarf_file_flags(argv[1], 0, &dwarfinfo, &e)){
+        printf("FAIL init: %s\n", sym_strerror(e));
+        return 1;
+    }
+
+    uint64_t *pcs = NULL;
+    int len = 0;
+
+    if(sym_get_pc_values_from_file_lineno(dwarfinfo, NULL, "split.c",
+                SPLIT_LINE, &pcs, &len, &e) || len == 0){
+        printf("FAIL split.c:%d has no PCs: %s\n", SPLIT_LINE,
+                sym_strerror(e));
+        free(pcs);
+        sym_end(&dwarfinfo);
+        return 1;
+    }
+
+    char *srcfilename = NULL, *srcfunction = NULL;
+    uint64_t srcfilelineno = 0;
+    void *cudie = NULL;
+
+    int failed = sym_get_line_info_from_pc(dwarfinfo, pcs[0], &srcfilename,
+            &srcfunction, &srcfilelineno, &cudie, &e) ||
+        !srcfilename || srcfilelineno != SPLIT_LINE;
+
+    if(failed){
+        printf("FAIL %#llx isn't split.c:%d: %s\n",
+                (unsigned long long)pcs[0], SPLIT_LINE, sym_strerror(e));
+    }
+    else{
+        printf("PASS %#llx is %s:%llu\n", (unsigned long long)pcs[0],
+                srcfilename, (unsigned long long)srcfilelineno);
+    }
+
+    free(srcfilename);
+    free(srcfunction);
+    free(pcs);
+
+    sym_end(&dwarfinfo);
+
+    return failed;
+}
@@ -0,0 +1,8 @@
+struct point {
+    int x;
+    int y;
+};
+
+int point_sum(struct point *p){
+    return p->x + p->y;
+}
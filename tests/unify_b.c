@@ -0,0 +1,12 @@
+struct point {
+    int x;
+    int y;
+};
+
+int point_sum(struct point *);
+
+int main(void){
+    struct point p = { 1, 2 };
+
+    return point_sum(&p) - 3;
+}
@@ -0,0 +1,47 @@
+#include <stdio.h>
+
+#include "sym.h"
+
+/* unify_a.c and unify_b.c both have struct point, so the second
+ * compilation unit's copy borrows the first one's members. sym_end
+ * frees the first compilation unit before the second, and must not
+ * look at those members again after that.
+ */
+static int unify_then_end(const char *file, int flags, const char *what){
+    sym_error_t e = {0};
+    void *dwarfinfo = NULL;
+
+    if(sym_init_with_dwarf_file_flags(file, flags, &dwarfinfo, &e)){
+        printf("FAIL %s: %s\n", what, sym_strerror(e));
+        return 1;
+    }
+
+    uint64_t saved = 0;
+
+    if(sym_get_unified_types_savings(dwarfinfo, &saved, &e) || saved == 0){
+        printf("FAIL %s: struct point wasn't unified\n", what);
+        sym_end(&dwarfinfo);
+        return 1;
+    }
+
+    sym_end(&dwarfinfo);
+
+    printf("PASS %s\n", what);
+
+    return 0;
+}
+
+int main(int argc, char **argv){
+    if(argc < 2){
+        puts("need a dwarf file");
+        return 1;
+    }
+
+    int failed = 0;
+
+    failed |= unify_then_end(argv[1], SYM_INIT_UNIFY_TYPES, "serial");
+    failed |= unify_then_end(argv[1],
+            SYM_INIT_UNIFY_TYPES | SYM_INIT_PARALLEL, "parallel");
+
+    return failed;
+}
@@ -0,0 +1,110 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "hashmap.h"
+
+/* Split up like the string pool so threads building different
+ * compilation units don't all wait on one lock.
+ */
+#define TYPECACHE_NUMSHARDS (16)
+#define TYPECACHE_CHUNK_SIZE (64 * 1024)
+
+struct typecache_shard {
+    pthread_mutex_t ts_lock;
+
+    /* Type DIE offset to its description */
+    struct hashmap *ts_types;
+
+    /* The descriptions themselves */
+    struct arena *ts_arena;
+};
+
+/* Every type DIE we've described, keyed by its .debug_info offset.
+ * Descriptions are owned by the cache, not by any compilation unit,
+ * so DIEs from different compilation units can share them. They
+ * stay valid until typecache_free.
+ */
+struct typecache {
+    struct typecache_shard tc_shards[TYPECACHE_NUMSHARDS];
+};
+
+struct typecache *typecache_new(void){
+    struct typecache *cache = malloc(sizeof(struct typecache));
+
+    for(int i=0; i<TYPECACHE_NUMSHARDS; i++){
+        struct typecache_shard *shard = &cache->tc_shards[i];
+
+        pthread_mutex_init(&shard->ts_lock, NULL);
+        shard->ts_types = hashmap_new();
+        shard->ts_arena = arena_new(TYPECACHE_CHUNK_SIZE);
+    }
+
+    return cache;
+}
+
+static struct typecache_shard *get_shard(struct typecache *cache,
+        uint64_t offset){
+    return &cache->tc_shards[offset % TYPECACHE_NUMSHARDS];
+}
+
+/* Zeroed memory for a description of the type at offset, freed with
+ * the cache.
+ */
+void *typecache_alloc(struct typecache *cache, uint64_t offset,
+        size_t size){
+    struct typecache_shard *shard = get_shard(cache, offset);
+
+    pthread_mutex_lock(&shard->ts_lock);
+    void *mem = arena_alloc(shard->ts_arena, size);
+    pthread_mutex_unlock(&shard->ts_lock);
+
+    return mem;
+}
+
+const void *typecache_find(struct typecache *cache, uint64_t offset){
+    struct typecache_shard *shard = get_shard(cache, offset);
+
+    pthread_mutex_lock(&shard->ts_lock);
+    const void *type = hashmap_get(shard->ts_types, offset);
+    pthread_mutex_unlock(&shard->ts_lock);
+
+    return type;
+}
+
+/* Two threads can describe the same type at the same time. The first
+ * one to get here wins and everyone uses what it returns.
+ */
+const void *typecache_insert(struct typecache *cache, uint64_t offset,
+        const void *type){
+    struct typecache_shard *shard = get_shard(cache, offset);
+
+    pthread_mutex_lock(&shard->ts_lock);
+
+    const void *existing = hashmap_get(shard->ts_types, offset);
+
+    if(existing)
+        type = existing;
+    else
+        hashmap_set(shard->ts_types, offset, (void *)type);
+
+    pthread_mutex_unlock(&shard->ts_lock);
+
+    return type;
+}
+
+void typecache_free(struct typecache *cache){
+    if(!cache)
+        return;
+
+    for(int i=0; i<TYPECACHE_NUMSHARDS; i++){
+        struct typecache_shard *shard = &cache->tc_shards[i];
+
+        pthread_mutex_destroy(&shard->ts_lock);
+        hashmap_free(shard->ts_types);
+        arena_free(shard->ts_arena);
+    }
+
+    free(cache);
+}
@@ -0,0 +1,13 @@
+#ifndef _TYPECACHE_H_
+#define _TYPECACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+void *typecache_alloc(void *, uint64_t, size_t);
+const void *typecache_find(void *, uint64_t);
+void typecache_free(void *);
+const void *typecache_insert(void *, uint64_t, const void *);
+void *typecache_new(void);
+
+#endif
@@ -0,0 +1,117 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "hashmap.h"
+
+struct unifiedtype {
+    /* Size of the type, from DW_AT_byte_size */
+    uint64_t ut_size;
+
+    /* Canonical DIE for every type with this layout */
+    void *ut_die;
+
+    struct unifiedtype *ut_next;
+};
+
+/* Structure and union types from every compilation unit built so far,
+ * keyed by a hash of their name, size, and member layout. Different
+ * compilation units which include the same header get the same types,
+ * so only the first one built keeps its own copy of the members.
+ */
+struct typeunify {
+    pthread_mutex_t tu_lock;
+
+    /* Layout hash to a chain of types with that hash */
+    struct hashmap *tu_types;
+
+    /* How many bytes of DIEs we didn't have to keep */
+    uint64_t tu_saved;
+};
+
+struct typeunify *typeunify_new(void){
+    struct typeunify *tu = malloc(sizeof(struct typeunify));
+
+    pthread_mutex_init(&tu->tu_lock, NULL);
+    tu->tu_types = hashmap_new();
+    tu->tu_saved = 0;
+
+    return tu;
+}
+
+void typeunify_add(struct typeunify *tu, uint64_t hash, uint64_t size,
+        void *die){
+    struct unifiedtype *type = malloc(sizeof(struct unifiedtype));
+    type->ut_size = size;
+    type->ut_die = die;
+
+    pthread_mutex_lock(&tu->tu_lock);
+
+    type->ut_next = hashmap_get(tu->tu_types, hash);
+    hashmap_set(tu->tu_types, hash, type);
+
+    pthread_mutex_unlock(&tu->tu_lock);
+}
+
+/* Returns the first canonical DIE with this hash and size for which
+ * same returns non-zero, or NULL.
+ */
+void *typeunify_find(struct typeunify *tu, uint64_t hash, uint64_t size,
+        int (*same)(void *, void *), void *arg){
+    void *found = NULL;
+
+    pthread_mutex_lock(&tu->tu_lock);
+
+    struct unifiedtype *type = hashmap_get(tu->tu_types, hash);
+
+    while(type){
+        if(type->ut_size == size && same(type->ut_die, arg)){
+            found = type->ut_die;
+            break;
+        }
+
+        type = type->ut_next;
+    }
+
+    pthread_mutex_unlock(&tu->tu_lock);
+
+    return found;
+}
+
+void typeunify_add_savings(struct typeunify *tu, uint64_t bytes){
+    pthread_mutex_lock(&tu->tu_lock);
+    tu->tu_saved += bytes;
+    pthread_mutex_unlock(&tu->tu_lock);
+}
+
+uint64_t typeunify_get_savings(struct typeunify *tu){
+    pthread_mutex_lock(&tu->tu_lock);
+    uint64_t saved = tu->tu_saved;
+    pthread_mutex_unlock(&tu->tu_lock);
+
+    return saved;
+}
+
+void typeunify_free(struct typeunify *tu){
+    if(!tu)
+        return;
+
+    struct hashmap *types = tu->tu_types;
+
+    for(uint64_t i=0; i<types->capacity; i++){
+        if(!types->entries[i].used)
+            continue;
+
+        struct unifiedtype *type = types->entries[i].value;
+
+        while(type){
+            struct unifiedtype *next = type->ut_next;
+            free(type);
+            type = next;
+        }
+    }
+
+    hashmap_free(types);
+    pthread_mutex_destroy(&tu->tu_lock);
+    free(tu);
+}
@@ -0,0 +1,14 @@
+#ifndef _TYPEUNIFY_H_
+#define _TYPEUNIFY_H_
+
+#include <stdint.h>
+
+void typeunify_add(void *, uint64_t, uint64_t, void *);
+void typeunify_add_savings(void *, uint64_t);
+void *typeunify_find(void *, uint64_t, uint64_t, int (*)(void *, void *),
+        void *);
+void typeunify_free(void *);
+uint64_t typeunify_get_savings(void *);
+void *typeunify_new(void);
+
+#endif